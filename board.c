@@ -0,0 +1,462 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "board.h"
+
+const char board_lurd[4] = { 'l', 'u', 'r', 'd' };
+
+uint64_t zobrist_box[BOARD_MAX_CELLS];
+uint64_t zobrist_player[BOARD_MAX_CELLS];
+
+/* SplitMix64 step, used to seed the Zobrist tables deterministically */
+static uint64_t splitmix64(uint64_t* state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/* Fill the Zobrist tables (idempotent) */
+void zobrist_init(void) {
+    static int initialized = 0;
+    uint64_t state = 0x50C0BA4ULL;
+    int i;
+
+    if (initialized) {
+        return;
+    }
+    for (i = 0; i < BOARD_MAX_CELLS; i++) {
+        zobrist_box[i] = splitmix64(&state);
+        zobrist_player[i] = splitmix64(&state);
+    }
+    initialized = 1;
+}
+
+/* Map a LURD character (either case) to a direction, or -1 */
+int board_dir_from_char(int ch) {
+    switch (ch) {
+        case 'l': case 'L': return DIR_LEFT;
+        case 'u': case 'U': return DIR_UP;
+        case 'r': case 'R': return DIR_RIGHT;
+        case 'd': case 'D': return DIR_DOWN;
+    }
+    return -1;
+}
+
+/* OR the bitboard in, shifted by n cells (n > 0 towards higher indices), into out */
+static void bb_shift_or(uint64_t* out, const uint64_t* in, int words, int n) {
+    int q, r, i;
+
+    if (n > 0) {
+        q = n >> 6;
+        r = n & 63;
+        for (i = words - 1; i >= q; i--) {
+            out[i] |= in[i - q] << r;
+            if (r && i - q - 1 >= 0) {
+                out[i] |= in[i - q - 1] >> (64 - r);
+            }
+        }
+    } else {
+        q = (-n) >> 6;
+        r = (-n) & 63;
+        for (i = 0; i + q < words; i++) {
+            out[i] |= in[i + q] >> r;
+            if (r && i + q + 1 < words) {
+                out[i] |= in[i + q + 1] << (64 - r);
+            }
+        }
+    }
+}
+
+/* Flood the player's reachable area as a bitboard: each round grows the
+ * set one step in all four directions with whole-word shifts and masks.
+ * The wall ring keeps row wrap-around out of the free mask. */
+void board_reach(const Board* board, const uint64_t* boxes, int pos, uint64_t* reach) {
+    uint64_t free_cells[BOARD_MAX_WORDS];
+    uint64_t grow[BOARD_MAX_WORDS];
+    uint64_t changed;
+    int words = board->words;
+    int i;
+
+    for (i = 0; i < words; i++) {
+        free_cells[i] = board->open[i] & ~boxes[i];
+        reach[i] = 0;
+    }
+    bb_set(reach, pos);
+
+    do {
+        for (i = 0; i < words; i++) {
+            grow[i] = 0;
+        }
+        bb_shift_or(grow, reach, words, 1);
+        bb_shift_or(grow, reach, words, -1);
+        bb_shift_or(grow, reach, words, board->stride);
+        bb_shift_or(grow, reach, words, -board->stride);
+
+        changed = 0;
+        for (i = 0; i < words; i++) {
+            grow[i] &= free_cells[i] & ~reach[i];
+            reach[i] |= grow[i];
+            changed |= grow[i];
+        }
+    } while (changed);
+}
+
+/* Smallest cell index the player can reach from pos around the given boxes,
+ * which names the player's region independently of where in it the player
+ * stands */
+int board_normalize(const Board* board, const uint64_t* boxes, int pos) {
+    uint64_t reach[BOARD_MAX_WORDS];
+
+    board_reach(board, boxes, pos, reach);
+    return bb_first(reach, board->words);
+}
+
+/* Shortest walk from one cell to another around the given boxes;
+ * fills dirs and returns its length, or -1 if the target is out of reach */
+int board_path(const Board* board, const uint64_t* boxes, int from, int to,
+               unsigned char* dirs) {
+    int queue[BOARD_MAX_CELLS];
+    signed char came[BOARD_MAX_CELLS];
+    int head = 0, tail = 0, n = 0;
+    int pos, d, next;
+
+    memset(came, -1, board->size);
+    came[from] = 4;
+    queue[tail++] = from;
+    while (head < tail && came[to] < 0) {
+        pos = queue[head++];
+        for (d = 0; d < 4; d++) {
+            next = pos + board->delta[d];
+            if (came[next] < 0 && (board->cells[next] & CELL_FLOOR) && !bb_test(boxes, next)) {
+                came[next] = (signed char)d;
+                queue[tail++] = next;
+            }
+        }
+    }
+    if (came[to] < 0) {
+        return -1;
+    }
+
+    /* Count the steps, then fill them in from the end */
+    for (pos = to; pos != from; pos -= board->delta[(int)came[pos]]) {
+        n++;
+    }
+    d = n;
+    for (pos = to; pos != from; pos -= board->delta[(int)came[pos]]) {
+        dirs[--d] = (unsigned char)came[pos];
+    }
+    return n;
+}
+
+/* Fewest pushes taking the box at box to target, the other boxes staying
+ * put. Searches (box cell, push direction) states, re-flooding the
+ * player's reach after every push. Fills pushes with box << 2 | dir
+ * entries and returns their count, or -1 if the box can not get there */
+int board_push_path(const Board* board, int box, int target, unsigned short* pushes) {
+    uint64_t boxes[BOARD_MAX_WORDS];
+    uint64_t reach[BOARD_MAX_WORDS];
+    int queue[BOARD_MAX_CELLS * 4];
+    int parent[BOARD_MAX_CELLS * 4];
+    int head = 0, tail = 0, n = 0;
+    int state, pos, d, dest, next;
+
+    if (!bb_test(board->boxes, box) || !(board->cells[target] & CELL_FLOOR) ||
+        (target != box && bb_test(board->boxes, target))) {
+        return -1;
+    }
+    if (box == target) {
+        return 0;
+    }
+
+    memset(parent, -1, board->size * 4 * sizeof(int));
+    board_reach(board, board->boxes, board->player, reach);
+    for (d = 0; d < 4; d++) {
+        if (bb_test(reach, box - board->delta[d])) {
+            state = box << 2 | d;
+            parent[state] = state;
+            queue[tail++] = state;
+        }
+    }
+
+    /* The moving box is put back in at its current cell for each flood */
+    memcpy(boxes, board->boxes, board->words * sizeof(uint64_t));
+    bb_clear(boxes, box);
+    while (head < tail) {
+        state = queue[head++];
+        pos = state >> 2;
+        dest = pos + board->delta[state & 3];
+        if (!(board->cells[dest] & CELL_FLOOR) || bb_test(boxes, dest)) {
+            continue;
+        }
+        if (dest == target) {
+            for (next = state; parent[next] != next; next = parent[next]) {
+                n++;
+            }
+            n++;
+            d = n;
+            for (next = state; ; next = parent[next]) {
+                pushes[--d] = (unsigned short)next;
+                if (parent[next] == next) {
+                    break;
+                }
+            }
+            return n;
+        }
+
+        bb_set(boxes, dest);
+        board_reach(board, boxes, pos, reach);
+        bb_clear(boxes, dest);
+        for (d = 0; d < 4; d++) {
+            next = dest << 2 | d;
+            if (parent[next] < 0 && bb_test(reach, dest - board->delta[d])) {
+                parent[next] = state;
+                queue[tail++] = next;
+            }
+        }
+    }
+    return -1;
+}
+
+/* Zobrist hash of the box positions alone */
+uint64_t board_box_hash(const Board* board) {
+    uint64_t hash = 0;
+    int pos;
+
+    for (pos = 0; pos < board->size; pos++) {
+        if (bb_test(board->boxes, pos)) {
+            hash ^= zobrist_box[pos];
+        }
+    }
+    return hash;
+}
+
+/* Size the single block for the bitboards and cell flags, reusing it when
+ * large enough; the old block stays if a larger one cannot be had */
+static int board_alloc(Board* board) {
+    int bytes = 2 * board->words * sizeof(uint64_t) + board->size;
+    uint64_t* block;
+
+    if (bytes > board->capacity) {
+        block = (uint64_t*)malloc(bytes);
+        if (!block) {
+            return -1;
+        }
+        free(board->boxes);
+        board->boxes = block;
+        board->capacity = bytes;
+    }
+    memset(board->boxes, 0, bytes);
+    board->open = board->boxes + board->words;
+    board->cells = (unsigned char*)(board->open + board->words);
+    return 0;
+}
+
+/* Mark every non-wall cell the player can walk to, ignoring boxes */
+static void board_mark_floor(Board* board) {
+    int stack[BOARD_MAX_CELLS];
+    int top = 0;
+    int pos, d, next;
+
+    stack[top++] = board->player;
+    board->cells[board->player] |= CELL_FLOOR;
+    bb_set(board->open, board->player);
+    while (top > 0) {
+        pos = stack[--top];
+        for (d = 0; d < 4; d++) {
+            next = pos + board->delta[d];
+            if (!(board->cells[next] & (CELL_WALL | CELL_FLOOR))) {
+                board->cells[next] |= CELL_FLOOR;
+                bb_set(board->open, next);
+                stack[top++] = next;
+            }
+        }
+    }
+}
+
+/* Parse level text into a padded board, returns 0 on success and -1 for no
+ * player, a second player or a level too large, leaving the board as it was.
+ * The board must start zeroed; its buffer is reused across calls. */
+int board_parse(Board* board, const char* data) {
+    const char* ptr;
+    int width = 0, height = 0, len = 0, players = 0;
+    int x, y, pos;
+    int player = -1;
+    Board saved = *board;
+
+    /* Find the dimensions and check the player before touching the board */
+    for (ptr = data; *ptr; ptr++) {
+        if (*ptr == '\n') {
+            height++;
+            len = 0;
+        } else if (*ptr != '\r' && ++len > width) {
+            width = len;
+        }
+        /* A second player is an error, not a silent override */
+        players += *ptr == PLAYER || *ptr == PLAYER_ON_GOAL;
+    }
+    if (len > 0) {
+        height++;
+    }
+    if (width == 0 || height == 0 || (width + 2) * (height + 2) > BOARD_MAX_CELLS ||
+        players != 1) {
+        return -1;
+    }
+
+    board->width = width;
+    board->height = height;
+    board->stride = width + 2;
+    board->size = board->stride * (height + 2);
+    board->words = (board->size + 63) / 64;
+    board->delta[DIR_LEFT] = -1;
+    board->delta[DIR_UP] = -board->stride;
+    board->delta[DIR_RIGHT] = 1;
+    board->delta[DIR_DOWN] = board->stride;
+    board->boxes_total = 0;
+    board->boxes_on_goal = 0;
+    board->goals_total = 0;
+
+    /* One block holds all layers */
+    if (board_alloc(board) != 0) {
+        *board = saved;
+        return -1;
+    }
+
+    /* The padding ring is solid wall so moves never need bounds checks */
+    for (x = 0; x < board->stride; x++) {
+        board->cells[x] = CELL_WALL | CELL_EDGE;
+        board->cells[board->size - board->stride + x] = CELL_WALL | CELL_EDGE;
+    }
+    for (y = 0; y < height + 2; y++) {
+        board->cells[y * board->stride] = CELL_WALL | CELL_EDGE;
+        board->cells[y * board->stride + board->stride - 1] = CELL_WALL | CELL_EDGE;
+    }
+
+    x = 0;
+    y = 0;
+    for (ptr = data; *ptr; ptr++) {
+        if (*ptr == '\n') {
+            x = 0;
+            y++;
+            continue;
+        }
+        if (*ptr == '\r') {
+            continue;
+        }
+        pos = (y + 1) * board->stride + (x + 1);
+        switch (*ptr) {
+            case WALL:
+                board->cells[pos] = CELL_WALL;
+                break;
+            case GOAL:
+                board->cells[pos] = CELL_GOAL;
+                break;
+            case BOX:
+                bb_set(board->boxes, pos);
+                break;
+            case BOX_ON_GOAL:
+                board->cells[pos] = CELL_GOAL;
+                bb_set(board->boxes, pos);
+                break;
+            case PLAYER_ON_GOAL:
+                board->cells[pos] = CELL_GOAL;
+                /* fall through */
+            case PLAYER:
+                player = pos;
+                break;
+        }
+        x++;
+    }
+
+    board->player = player;
+    board_mark_floor(board);
+
+    for (pos = 0; pos < board->size; pos++) {
+        if (board->cells[pos] & CELL_GOAL) {
+            board->goals_total++;
+        }
+        if (bb_test(board->boxes, pos)) {
+            board->boxes_total++;
+            if (board->cells[pos] & CELL_GOAL) {
+                board->boxes_on_goal++;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/* Count set bits in a word */
+static int popcount64(uint64_t w) {
+    int n = 0;
+
+    while (w) {
+        w &= w - 1;
+        n++;
+    }
+    return n;
+}
+
+/* Load a pre-parsed level: the box plane is copied as is and the static
+ * planes are unpacked into cell flags, no text scanning involved. On failure
+ * the board is left as it was */
+int board_load(Board* board, const EmbeddedLevel* level) {
+    int pos, i, x, y;
+    uint64_t bit;
+    Board saved = *board;
+
+    if ((level->width + 2) * (level->height + 2) > BOARD_MAX_CELLS) {
+        return -1;
+    }
+    board->width = level->width;
+    board->height = level->height;
+    board->stride = level->width + 2;
+    board->size = board->stride * (level->height + 2);
+    board->words = (board->size + 63) / 64;
+    board->delta[DIR_LEFT] = -1;
+    board->delta[DIR_UP] = -board->stride;
+    board->delta[DIR_RIGHT] = 1;
+    board->delta[DIR_DOWN] = board->stride;
+    board->player = level->player;
+    board->boxes_total = level->boxes;
+    board->boxes_on_goal = 0;
+    board->goals_total = 0;
+
+    if (board_alloc(board) != 0) {
+        *board = saved;
+        return -1;
+    }
+    memcpy(board->boxes, level->box_bits, board->words * sizeof(uint64_t));
+    memcpy(board->open, level->floor, board->words * sizeof(uint64_t));
+
+    for (i = 0; i < board->words; i++) {
+        board->goals_total += popcount64(level->goals[i]);
+        board->boxes_on_goal += popcount64(level->goals[i] & level->box_bits[i]);
+    }
+
+    for (pos = 0; pos < board->size; pos++) {
+        bit = (uint64_t)1 << (pos & 63);
+        board->cells[pos] = ((level->walls[pos >> 6] & bit) ? CELL_WALL : 0) |
+                            ((level->goals[pos >> 6] & bit) ? CELL_GOAL : 0) |
+                            ((level->floor[pos >> 6] & bit) ? CELL_FLOOR : 0);
+    }
+    for (x = 0; x < board->stride; x++) {
+        board->cells[x] |= CELL_EDGE;
+        board->cells[board->size - board->stride + x] |= CELL_EDGE;
+    }
+    for (y = 0; y < board->height + 2; y++) {
+        board->cells[y * board->stride] |= CELL_EDGE;
+        board->cells[y * board->stride + board->stride - 1] |= CELL_EDGE;
+    }
+
+    return 0;
+}
+
+/* Free the board layers */
+void board_free(Board* board) {
+    free(board->boxes);
+    board->cells = NULL;
+    board->boxes = NULL;
+    board->open = NULL;
+    board->capacity = 0;
+}
@@ -0,0 +1,113 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <stdint.h>
+
+#include "levels.h"
+
+/* Largest padded board (stride * rows) the engine handles */
+#define BOARD_MAX_CELLS 4096
+#define BOARD_MAX_WORDS (BOARD_MAX_CELLS / 64)
+
+/* Static cell flags */
+#define CELL_WALL  0x01  /* wall, including the padding border */
+#define CELL_GOAL  0x02  /* goal square */
+#define CELL_FLOOR 0x04  /* inside the level, reachable by the player */
+#define CELL_DEAD  0x08  /* floor a box can never be pushed to a goal from */
+#define CELL_EDGE  0x10  /* padding ring around the level (also CELL_WALL) */
+
+/* Directions, in LURD order */
+#define DIR_LEFT  0
+#define DIR_UP    1
+#define DIR_RIGHT 2
+#define DIR_DOWN  3
+
+/* Board state: cells are indexed as (y + 1) * stride + (x + 1) */
+typedef struct {
+    int width;              /* Level width without padding */
+    int height;             /* Level height without padding */
+    int stride;             /* Padded row length */
+    int size;               /* Padded cell count */
+    int words;              /* Bitboard length in 64-bit words */
+    int delta[4];           /* Index offset per direction */
+    int player;             /* Player cell index */
+    int boxes_total;
+    int boxes_on_goal;
+    int goals_total;
+    unsigned char* cells;   /* Static layer: CELL_* flags */
+    uint64_t* boxes;        /* Dynamic layer: box bitboard */
+    uint64_t* open;         /* Bitboard of CELL_FLOOR cells, for flood fills */
+    int capacity;           /* Bytes allocated for all layers */
+} Board;
+
+/* LURD characters, indexed by direction (push = uppercase) */
+extern const char board_lurd[4];
+
+/* Zobrist keys per cell index */
+extern uint64_t zobrist_box[BOARD_MAX_CELLS];
+extern uint64_t zobrist_player[BOARD_MAX_CELLS];
+
+void zobrist_init(void);
+int board_parse(Board* board, const char* data);
+int board_load(Board* board, const EmbeddedLevel* level);
+void board_free(Board* board);
+int board_dir_from_char(int ch);
+void board_reach(const Board* board, const uint64_t* boxes, int pos, uint64_t* reach);
+int board_normalize(const Board* board, const uint64_t* boxes, int pos);
+int board_path(const Board* board, const uint64_t* boxes, int from, int to,
+               unsigned char* dirs);
+int board_push_path(const Board* board, int box, int target, unsigned short* pushes);
+uint64_t board_box_hash(const Board* board);
+
+/* Cell index of a level coordinate */
+static inline int board_pos(const Board* board, int x, int y) {
+    return (y + 1) * board->stride + x + 1;
+}
+
+/* True for level walls, false for the padding ring */
+static inline int board_is_wall(const Board* board, int pos) {
+    return (board->cells[pos] & (CELL_WALL | CELL_EDGE)) == CELL_WALL;
+}
+
+/* Bitboard helpers */
+static inline int bb_test(const uint64_t* bb, int pos) {
+    return (int)((bb[pos >> 6] >> (pos & 63)) & 1);
+}
+
+static inline void bb_set(uint64_t* bb, int pos) {
+    bb[pos >> 6] |= (uint64_t)1 << (pos & 63);
+}
+
+static inline void bb_clear(uint64_t* bb, int pos) {
+    bb[pos >> 6] &= ~((uint64_t)1 << (pos & 63));
+}
+
+/* Lowest set cell index, or -1 when empty */
+static inline int bb_first(const uint64_t* bb, int words) {
+    int i;
+
+    for (i = 0; i < words; i++) {
+        if (bb[i]) {
+            return i * 64 + __builtin_ctzll(bb[i]);
+        }
+    }
+    return -1;
+}
+
+/* Cell contents in the levels.h encoding */
+static inline char board_char(const Board* board, int pos) {
+    unsigned char cell = board->cells[pos];
+
+    if (cell & CELL_WALL) {
+        return (cell & CELL_EDGE) ? EMPTY : WALL;
+    }
+    if (bb_test(board->boxes, pos)) {
+        return (cell & CELL_GOAL) ? BOX_ON_GOAL : BOX;
+    }
+    if (pos == board->player) {
+        return (cell & CELL_GOAL) ? PLAYER_ON_GOAL : PLAYER;
+    }
+    return (cell & CELL_GOAL) ? GOAL : EMPTY;
+}
+
+#endif /* BOARD_H */
@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "collection.h"
+#include "import.h"
+
+/* End of the line starting at pos, not counting the newline */
+static size_t line_end(const Collection* c, size_t pos) {
+    const char* nl = memchr(c->data + pos, '\n', c->size - pos);
+
+    return nl ? (size_t)(nl - c->data) : c->size;
+}
+
+/* Append a level's map offsets to the index */
+static int add_map(Collection* c, size_t start, size_t end) {
+    size_t* grown;
+
+    if (c->count == c->capacity) {
+        c->capacity = c->capacity ? c->capacity * 2 : 256;
+        grown = (size_t*)realloc(c->maps, c->capacity * 2 * sizeof(size_t));
+        if (!grown) {
+            return -1;
+        }
+        c->maps = grown;
+    }
+    c->maps[c->count * 2] = start;
+    c->maps[c->count * 2 + 1] = end;
+    c->count++;
+    return 0;
+}
+
+/* Offset of the next "<tag" at or after pos whose name is exactly tag */
+static size_t find_tag(const Collection* c, size_t pos, const char* tag) {
+    size_t len = strlen(tag);
+    const char* lt;
+
+    while (pos < c->size && (lt = memchr(c->data + pos, '<', c->size - pos)) != NULL) {
+        pos = lt - c->data;
+        if (c->size - pos > len + 1 && memcmp(lt + 1, tag, len) == 0 &&
+            strchr(" \t\r\n/>", lt[len + 1])) {
+            return pos;
+        }
+        pos++;
+    }
+    return c->size;
+}
+
+/* SLC collections: each <Level>...</Level> element is one level */
+static int index_xml(Collection* c) {
+    size_t start, end;
+
+    for (start = find_tag(c, 0, "Level"); start < c->size; start = find_tag(c, end, "Level")) {
+        end = find_tag(c, start, "/Level");
+        if (end == c->size) {
+            break;
+        }
+        end += strlen("</Level>");
+        if (add_map(c, start, end) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Map the file and index where each level's map starts and ends, 16 bytes
+ * a level; the levels themselves are only parsed by collection_load */
+int collection_open(Collection* c, const char* path) {
+    struct stat st;
+    size_t pos, end, start = 0;
+    int fd, in_map = 0;
+    void* data;
+
+    memset(c, 0, sizeof(*c));
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return -1;
+    }
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return -1;
+    }
+    c->data = (const char*)data;
+    c->size = st.st_size;
+
+    for (pos = 0; pos < c->size && c->data[pos] && strchr(" \t\r\n\xEF\xBB\xBF", c->data[pos]); pos++) {
+    }
+    if (pos < c->size && c->data[pos] == '<') {
+        c->xml = 1;
+        if (index_xml(c) != 0) {
+            collection_close(c);
+            return -1;
+        }
+    }
+
+    for (pos = 0; !c->xml && pos < c->size; pos = end + 1) {
+        end = line_end(c, pos);
+        if (import_map_line(c->data + pos, end - pos)) {
+            if (!in_map) {
+                start = pos;
+                in_map = 1;
+            }
+        } else if (in_map) {
+            in_map = 0;
+            if (add_map(c, start, pos) != 0) {
+                collection_close(c);
+                return -1;
+            }
+        }
+    }
+    if (in_map && add_map(c, start, c->size) != 0) {
+        collection_close(c);
+        return -1;
+    }
+
+    if (c->count == 0) {
+        collection_close(c);
+        return -1;
+    }
+    return 0;
+}
+
+/* Where collection_load() puts the level */
+typedef struct {
+    Board* board;
+    char* title;
+    size_t title_size;
+    int status;
+} LoadTarget;
+
+/* Find the level's title: a "Title:" line after the map, else a text line
+ * right before it, else its number */
+static void find_title(const Collection* c, int index, char* title, size_t title_size) {
+    size_t start = c->maps[index * 2];
+    size_t pos = c->maps[index * 2 + 1];
+    size_t stop = index + 1 < c->count ? c->maps[(index + 1) * 2] : c->size;
+    size_t end, prev;
+
+    for (; pos < stop; pos = end + 1) {
+        end = line_end(c, pos);
+        if (end - pos > 6 && strncmp(c->data + pos, "Title:", 6) == 0) {
+            import_title(title, title_size, c->data + pos + 6, end - pos - 6);
+            return;
+        }
+    }
+
+    if (start > 0) {
+        end = start - 1;
+        for (prev = end; prev > 0 && c->data[prev - 1] != '\n'; prev--) {
+        }
+        import_title(title, title_size, c->data + prev, end - prev);
+        if (*title) {
+            return;
+        }
+    }
+    snprintf(title, title_size, "Level %d", index + 1);
+}
+
+/* Importer callback: parse the first level into the board */
+static int load_first(void* context, const char* title, const char* map) {
+    LoadTarget* target = (LoadTarget*)context;
+
+    target->status = import_playable(map) ? board_parse(target->board, map) : -1;
+    import_title(target->title, target->title_size, title, strlen(title));
+    return 1;
+}
+
+/* Parse one level of the pack into the board, returns 0 on success */
+int collection_load(const Collection* c, int index, Board* board,
+                    char* title, size_t title_size) {
+    LoadTarget target = { board, title, title_size, -1 };
+    Importer importer;
+    size_t start;
+
+    if (index < 0 || index >= c->count) {
+        return -1;
+    }
+    start = c->maps[index * 2];
+    *title = '\0';
+    import_init(&importer, load_first, &target);
+    import_feed(&importer, c->data + start, c->maps[index * 2 + 1] - start);
+    import_finish(&importer);
+
+    if (*title == '\0') {
+        if (c->xml) {
+            snprintf(title, title_size, "Level %d", index + 1);
+        } else {
+            find_title(c, index, title, title_size);
+        }
+    }
+    return target.status;
+}
+
+/* Unmap the file and free the index */
+void collection_close(Collection* c) {
+    if (c->data) {
+        munmap((void*)c->data, c->size);
+    }
+    free(c->maps);
+    memset(c, 0, sizeof(*c));
+}
@@ -0,0 +1,25 @@
+#ifndef COLLECTION_H
+#define COLLECTION_H
+
+#include <stddef.h>
+
+#include "board.h"
+
+/* A level pack file mapped into memory: XSB maps (rows may be run-length
+ * encoded) separated by blank or text lines, with titles as "Title: ..."
+ * after a map or a line before it, or an SLC (XML) collection */
+typedef struct {
+    const char* data;       /* The mapped file */
+    size_t size;
+    size_t* maps;           /* Start and end offset of each level's map lines */
+    int count;
+    int capacity;
+    int xml;                /* SLC: each range is a <Level> element */
+} Collection;
+
+int collection_open(Collection* collection, const char* path);
+int collection_load(const Collection* collection, int index, Board* board,
+                    char* title, size_t title_size);
+void collection_close(Collection* collection);
+
+#endif /* COLLECTION_H */
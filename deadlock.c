@@ -0,0 +1,161 @@
+#include "deadlock.h"
+
+/* Boxes that can take part in one freeze check */
+#define MAX_FROZEN 64
+
+/* Boxes treated as walls while checking a frozen cluster */
+typedef struct {
+    const Board* board;
+    const uint64_t* boxes;
+    int frozen[MAX_FROZEN];
+    int count;
+    int off_goal;
+} Freeze;
+
+/* Compute dead squares by pulling a box backwards from every goal,
+ * returns the number of dead floor cells */
+int deadlock_mark_dead(Board* board) {
+    int queue[BOARD_MAX_CELLS];
+    unsigned char live[BOARD_MAX_CELLS];
+    int head = 0, tail = 0, dead = 0;
+    int pos, d, from;
+
+    for (pos = 0; pos < board->size; pos++) {
+        live[pos] = 0;
+        if ((board->cells[pos] & CELL_GOAL) && (board->cells[pos] & CELL_FLOOR)) {
+            live[pos] = 1;
+            queue[tail++] = pos;
+        }
+    }
+
+    /* A box on pos could have come from pos - delta if the player had room behind it */
+    while (head < tail) {
+        pos = queue[head++];
+        for (d = 0; d < 4; d++) {
+            from = pos - board->delta[d];
+            if (!live[from] && (board->cells[from] & CELL_FLOOR) &&
+                (board->cells[from - board->delta[d]] & CELL_FLOOR)) {
+                live[from] = 1;
+                queue[tail++] = from;
+            }
+        }
+    }
+
+    for (pos = 0; pos < board->size; pos++) {
+        board->cells[pos] &= ~CELL_DEAD;
+        if ((board->cells[pos] & CELL_FLOOR) && !live[pos]) {
+            board->cells[pos] |= CELL_DEAD;
+            dead++;
+        }
+    }
+    return dead;
+}
+
+static int freeze_is_wall(const Freeze* f, int pos) {
+    int i;
+
+    if (f->board->cells[pos] & CELL_WALL) {
+        return 1;
+    }
+    for (i = 0; i < f->count; i++) {
+        if (f->frozen[i] == pos) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int box_frozen(Freeze* f, int pos);
+
+/* A box can not move along an axis if either side is blocked for good */
+static int axis_blocked(Freeze* f, int pos, int d1, int d2) {
+    const Board* b = f->board;
+    int a = pos + b->delta[d1];
+    int c = pos + b->delta[d2];
+
+    if (freeze_is_wall(f, a) || freeze_is_wall(f, c)) {
+        return 1;
+    }
+    if ((b->cells[a] & CELL_DEAD) && (b->cells[c] & CELL_DEAD)) {
+        return 1;
+    }
+    if (bb_test(f->boxes, a) && box_frozen(f, a)) {
+        return 1;
+    }
+    if (bb_test(f->boxes, c) && box_frozen(f, c)) {
+        return 1;
+    }
+    return 0;
+}
+
+/* Check both axes, treating this box as a wall to break cycles */
+static int box_frozen(Freeze* f, int pos) {
+    int count = f->count;
+    int off_goal = f->off_goal;
+    int frozen;
+
+    if (f->count == MAX_FROZEN) {
+        return 0;
+    }
+    f->frozen[f->count++] = pos;
+    frozen = axis_blocked(f, pos, DIR_LEFT, DIR_RIGHT) &&
+             axis_blocked(f, pos, DIR_UP, DIR_DOWN);
+    if (!frozen) {
+        /* Anything decided while this box counted as a wall no longer holds */
+        f->count = count;
+        f->off_goal = off_goal;
+    } else if (!(f->board->cells[pos] & CELL_GOAL)) {
+        f->off_goal = 1;
+    }
+    return frozen;
+}
+
+/* Every 2x2 block around pos made of walls and boxes, with a box off goal */
+static int square_deadlock(const Board* b, const uint64_t* boxes, int pos) {
+    static const int corners[4][2] = {
+        { DIR_LEFT, DIR_UP }, { DIR_RIGHT, DIR_UP },
+        { DIR_LEFT, DIR_DOWN }, { DIR_RIGHT, DIR_DOWN }
+    };
+    int cell[4];
+    int i, j, blocked, off_goal;
+
+    for (i = 0; i < 4; i++) {
+        cell[0] = pos;
+        cell[1] = pos + b->delta[corners[i][0]];
+        cell[2] = pos + b->delta[corners[i][1]];
+        cell[3] = cell[1] + b->delta[corners[i][1]];
+        blocked = 1;
+        off_goal = 0;
+        for (j = 0; j < 4 && blocked; j++) {
+            if (bb_test(boxes, cell[j])) {
+                if (!(b->cells[cell[j]] & CELL_GOAL)) {
+                    off_goal = 1;
+                }
+            } else if (!(b->cells[cell[j]] & CELL_WALL)) {
+                blocked = 0;
+            }
+        }
+        if (blocked && off_goal) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Check dead squares, 2x2 blocks and frozen boxes around a pushed box */
+int deadlock_after_push(const Board* board, const uint64_t* boxes, int pos) {
+    Freeze f;
+
+    if (board->cells[pos] & CELL_DEAD) {
+        return 1;
+    }
+    if (square_deadlock(board, boxes, pos)) {
+        return 1;
+    }
+
+    f.board = board;
+    f.boxes = boxes;
+    f.count = 0;
+    f.off_goal = 0;
+    return box_frozen(&f, pos) && f.off_goal;
+}
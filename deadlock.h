@@ -0,0 +1,12 @@
+#ifndef DEADLOCK_H
+#define DEADLOCK_H
+
+#include "board.h"
+
+/* Mark floor cells a box can never leave for a goal with CELL_DEAD */
+int deadlock_mark_dead(Board* board);
+
+/* Non-zero if the box just pushed to pos leaves the level unsolvable */
+int deadlock_after_push(const Board* board, const uint64_t* boxes, int pos);
+
+#endif /* DEADLOCK_H */
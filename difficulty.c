@@ -0,0 +1,42 @@
+#include <math.h>
+#include <string.h>
+
+#include "difficulty.h"
+#include "deadlock.h"
+#include "solver.h"
+
+/* Solve a level for pushes and for moves, single-threaded so whole levels
+ * can be measured in parallel; returns 0 when the push search succeeded */
+int difficulty_measure(const Board* board, long max_nodes, Difficulty* d) {
+    unsigned char cells[BOARD_MAX_CELLS];
+    SolveOptions options = { SOLVE_PUSHES, max_nodes, 1 };
+    SolveResult result;
+    Board local = *board;
+
+    memset(d, 0, sizeof(*d));
+    d->boxes = board->boxes_total;
+    d->moves = -1;
+    memcpy(cells, board->cells, board->size);
+    local.cells = cells;
+    d->dead_squares = deadlock_mark_dead(&local);
+
+    if (solve_board(board, &options, &result) == 0) {
+        d->solved = 1;
+        d->pushes = result.pushes;
+    }
+    d->expanded = result.expanded;
+    d->branching = result.expanded ? (double)result.generated / result.expanded : 0.0;
+    solve_result_free(&result);
+
+    options.metric = SOLVE_MOVES;
+    if (d->solved && solve_board(board, &options, &result) == 0) {
+        d->moves = result.moves;
+    }
+    solve_result_free(&result);
+
+    /* Search effort dominates, in bits so it grows with the log of the
+     * positions; the push count separates levels the search finds equally
+     * easy. Anything unsolved sorts last. */
+    d->score = d->solved ? 10.0 * log2(1.0 + d->expanded) + d->pushes : 1e9;
+    return d->solved ? 0 : -1;
+}
@@ -0,0 +1,20 @@
+#ifndef DIFFICULTY_H
+#define DIFFICULTY_H
+
+#include "board.h"
+
+/* How hard a level is, measured by solving it */
+typedef struct {
+    int solved;             /* Push-optimal solution found within the budget */
+    int pushes;             /* Fewest pushes */
+    int moves;              /* Fewest moves, or -1 if that search ran out of budget */
+    long expanded;          /* Positions the push search expanded */
+    double branching;       /* Pushes generated per expanded position */
+    int dead_squares;       /* Floor cells a box can never leave for a goal */
+    int boxes;
+    double score;           /* Single number to sort by, higher is harder */
+} Difficulty;
+
+int difficulty_measure(const Board* board, long max_nodes, Difficulty* difficulty);
+
+#endif /* DIFFICULTY_H */
@@ -2,76 +2,552 @@
 #include <stdlib.h>
 #include <string.h>
 #include <dirent.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "board.h"
+#include "import.h"
+#include "difficulty.h"
+#include "solver.h"
+#include "engine.h"
 
 #define MAX_PATH 1024
-#define MAX_LINE 256
 
-// Function to process a single level file
-void process_level_file(FILE* output, const char* filename, int is_last) {
+// Solver budget per level when measuring difficulty
+#define DEFAULT_MAX_NODES 4000000
+
+// Solutions of earlier builds, by level text hash
+#define SOLUTION_CACHE "solutions.cache"
+
+// Summary of a level, written to the table after all bitplanes
+typedef struct {
+    char name[MAX_PATH];
+    int width;
+    int height;
+    int player;
+    int boxes;
+    char* map;              // Level text, kept only to measure or validate
+    Difficulty difficulty;
+    char problem[128];      // What --validate found wrong, empty if nothing
+    uint64_t hash;          // Of the level text, keys the solution cache
+    char* lurd;             // Solution found or cached, NULL if none
+} LevelInfo;
+
+// Write one bitplane of the padded board as an array of 64-bit words
+static void write_plane(FILE* output, int index, const char* plane, const Board* board,
+                        int flag) {
+    int i, pos;
+    uint64_t word;
+
+    fprintf(output, "static const uint64_t level%d_%s[] = {", index, plane);
+    for (i = 0; i < board->words; i++) {
+        word = 0;
+        for (pos = i * 64; pos < (i + 1) * 64 && pos < board->size; pos++) {
+            if (flag ? (board->cells[pos] & flag) != 0 : bb_test(board->boxes, pos)) {
+                word |= (uint64_t)1 << (pos & 63);
+            }
+        }
+        fprintf(output, "%s0x%016llxULL", i ? ", " : " ", (unsigned long long)word);
+    }
+    fprintf(output, " };\n");
+}
+
+// Levels collected so far, shared by the importer callback
+typedef struct {
+    FILE* output;
+    const char* file;
+    LevelInfo* info;
+    int count;
+    int capacity;
+    int file_levels;
+    int failed;
+    int keep_maps;
+    int validate;           // Only collect the levels, checks come later
+} Embedder;
+
+// Work done on one level by the threads; parsed is board_parse()'s result
+typedef void (*LevelWork)(LevelInfo* info, Board* board, int parsed, long max_nodes);
+
+// Levels handed out one at a time to the threads
+typedef struct {
+    Embedder* embedder;
+    LevelWork work;
+    long max_nodes;
+    atomic_int next;
+} Pool;
+
+// Importer callback: write one level's bitplanes and note its summary
+static int embed_level(void* context, const char* title, const char* map) {
+    Embedder* e = (Embedder*)context;
+    LevelInfo* grown;
+    Board board;
+    int index = e->count;
+
+    e->file_levels++;
+    if (e->count == e->capacity) {
+        grown = (LevelInfo*)realloc(e->info, (e->capacity ? e->capacity * 2 : 64) *
+                                    sizeof(LevelInfo));
+        if (!grown) {
+            fprintf(stderr, "Error: Memory allocation failed\n");
+            e->failed = 1;
+            return 1;
+        }
+        e->info = grown;
+        e->capacity = e->capacity ? e->capacity * 2 : 64;
+    }
+
+    // Validation checks each level later, in parallel
+    if (e->validate) {
+        memset(&e->info[index], 0, sizeof(LevelInfo));
+        snprintf(e->info[index].name, sizeof(e->info[index].name), "%s", title);
+        e->info[index].map = strdup(map);
+        if (!e->info[index].map) {
+            fprintf(stderr, "Error: Memory allocation failed\n");
+            e->failed = 1;
+            return 1;
+        }
+        e->count++;
+        return 0;
+    }
+
+    // Parse once here so the game never has to
+    memset(&board, 0, sizeof(board));
+    if (board_parse(&board, map) != 0) {
+        fprintf(stderr, "Error: %s: level %d: no single player or level too large\n",
+                e->file, e->file_levels);
+        e->failed = 1;
+    } else if (board.boxes_total == 0 || board.boxes_total != board.goals_total) {
+        fprintf(stderr, "Error: %s: level %d: %d boxes but %d goals\n", e->file,
+                e->file_levels, board.boxes_total, board.goals_total);
+        e->failed = 1;
+    } else {
+        fprintf(e->output, "/* %s%s%s */\n", e->file, *title ? ": " : "", title);
+        write_plane(e->output, index, "walls", &board, CELL_WALL);
+        write_plane(e->output, index, "goals", &board, CELL_GOAL);
+        write_plane(e->output, index, "floor", &board, CELL_FLOOR);
+        write_plane(e->output, index, "boxes", &board, 0);
+        fprintf(e->output, "\n");
+
+        // Named once the whole file is read, titles for now
+        snprintf(e->info[index].name, sizeof(e->info[index].name), "%s", title);
+        e->info[index].width = board.width;
+        e->info[index].height = board.height;
+        e->info[index].player = board.player;
+        e->info[index].boxes = board.boxes_total;
+        e->info[index].map = e->keep_maps ? strdup(map) : NULL;
+        if (e->keep_maps && !e->info[index].map) {
+            fprintf(stderr, "Error: Memory allocation failed\n");
+            e->failed = 1;
+        }
+        e->count++;
+    }
+
+    board_free(&board);
+    return 0;
+}
+
+// Function to process a level file (.sok, possibly run-length encoded, or an
+// .slc collection), returns 0 on success
+int process_level_file(Embedder* e, const char* filename) {
     FILE* input;
-    char line[MAX_LINE];
-    char* base_name;
+    const char* base_name;
+    char name[MAX_PATH];
+    int first = e->count;
+    int status, i;
 
     // Get base name from path
     base_name = strrchr(filename, '/');
     if (base_name) {
         base_name++; // Skip the '/'
     } else {
-        base_name = (char*)filename;
+        base_name = filename;
     }
 
     // Open the input file
     input = fopen(filename, "r");
     if (!input) {
         fprintf(stderr, "Error: Could not open file: %s\n", filename);
+        return -1;
+    }
+
+    if (!e->validate) {
+        printf("Processing %s...\n", base_name);
+    }
+
+    // Stream the file through the importer, one level at a time
+    e->file = base_name;
+    e->file_levels = 0;
+    status = import_file(input, embed_level, e);
+    fclose(input);
+    if (status != 0) {
+        fprintf(stderr, "Error: %s: read failed\n", filename);
+        return -1;
+    }
+    if (e->file_levels == 0) {
+        fprintf(stderr, "Error: %s: no level found\n", filename);
+        return -1;
+    }
+
+    // A single level keeps its file's name, a collection's levels their titles
+    for (i = first; i < e->count; i++) {
+        if (e->file_levels == 1) {
+            snprintf(name, sizeof(name), "%s", base_name);
+        } else if (e->info[i].name[0]) {
+            snprintf(name, sizeof(name), "%s", e->info[i].name);
+        } else {
+            snprintf(name, sizeof(name), "%s#%d", base_name, i - first + 1);
+        }
+        memcpy(e->info[i].name, name, sizeof(name));
+    }
+    return 0;
+}
+
+// Write a string as a C string literal
+static void write_string(FILE* output, const char* text) {
+    fputc('"', output);
+    for (; *text; text++) {
+        if (*text == '"' || *text == '\\') {
+            fputc('\\', output);
+        }
+        fputc(*text, output);
+    }
+    fputc('"', output);
+}
+
+// Thread body: take levels until none are left
+static void* level_worker(void* arg) {
+    Pool* pool = (Pool*)arg;
+    LevelInfo* info;
+    Board board;
+    int i;
+
+    memset(&board, 0, sizeof(board));
+    while ((i = atomic_fetch_add(&pool->next, 1)) < pool->embedder->count) {
+        info = &pool->embedder->info[i];
+        pool->work(info, &board, board_parse(&board, info->map), pool->max_nodes);
+    }
+    board_free(&board);
+    return NULL;
+}
+
+// Run work on every level, spread over threads; whole levels are the unit
+// of work, so each solve stays single-threaded
+static void for_each_level(Embedder* e, LevelWork work, int threads, long max_nodes) {
+    Pool pool;
+    pthread_t* tids;
+    int i;
+
+    pool.embedder = e;
+    pool.work = work;
+    pool.max_nodes = max_nodes;
+    atomic_init(&pool.next, 0);
+    if (threads > e->count) {
+        threads = e->count;
+    }
+    tids = (pthread_t*)malloc(threads * sizeof(pthread_t));
+    if (!tids) {
+        level_worker(&pool);
         return;
     }
+    for (i = 0; i < threads; i++) {
+        pthread_create(&tids[i], NULL, level_worker, &pool);
+    }
+    for (i = 0; i < threads; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    free(tids);
+}
 
-    printf("Processing %s...\n", base_name);
+static void measure_level(LevelInfo* info, Board* board, int parsed, long max_nodes) {
+    if (parsed == 0) {
+        difficulty_measure(board, max_nodes, &info->difficulty);
+    }
+}
 
-    // Start the level entry
-    fprintf(output, "    {\n");
-    fprintf(output, "        \"%s\",\n", base_name);
-    fprintf(output, "        \"");
+// Note the first of these that fails: one player, as many boxes as goals,
+// walls all around, every box and goal where the player can get, and a
+// solution within the node budget
+static void validate_level(LevelInfo* info, Board* board, int parsed, long max_nodes) {
+    SolveOptions options = { SOLVE_PUSHES, max_nodes, 1 };
+    SolveResult result;
+    const char* ptr;
+    int players = 0, pos, d;
 
-    // Process each line of the level file
-    while (fgets(line, sizeof(line), input)) {
-        char* p = line;
-        size_t len = strlen(line);
+    for (ptr = info->map; *ptr; ptr++) {
+        if (*ptr == PLAYER || *ptr == PLAYER_ON_GOAL) {
+            players++;
+        }
+    }
+    if (players != 1) {
+        snprintf(info->problem, sizeof(info->problem), "%d players", players);
+        return;
+    }
+    if (parsed != 0) {
+        snprintf(info->problem, sizeof(info->problem), "level too large");
+        return;
+    }
+    if (board->boxes_total == 0 || board->boxes_total != board->goals_total) {
+        snprintf(info->problem, sizeof(info->problem), "%d boxes but %d goals",
+                 board->boxes_total, board->goals_total);
+        return;
+    }
 
-        // Remove trailing newline if present
-        if (len > 0 && (line[len-1] == '\n' || line[len-1] == '\r')) {
-            line[--len] = '\0';
-            if (len > 0 && line[len-1] == '\r') {
-                line[--len] = '\0';
+    for (pos = 0; pos < board->size; pos++) {
+        if (board->cells[pos] & CELL_FLOOR) {
+            for (d = 0; d < 4; d++) {
+                if (board->cells[pos + board->delta[d]] & CELL_EDGE) {
+                    snprintf(info->problem, sizeof(info->problem),
+                             "not enclosed: floor at %d,%d reaches the edge",
+                             pos % board->stride - 1, pos / board->stride - 1);
+                    return;
+                }
             }
+        } else if (bb_test(board->boxes, pos) || (board->cells[pos] & CELL_GOAL)) {
+            snprintf(info->problem, sizeof(info->problem), "%s at %d,%d is out of reach",
+                     bb_test(board->boxes, pos) ? "box" : "goal",
+                     pos % board->stride - 1, pos / board->stride - 1);
+            return;
         }
+    }
 
-        // Escape backslashes and double quotes
-        while (*p) {
-            if (*p == '\\' || *p == '\"') {
-                fprintf(output, "\\%c", *p);
-            } else if (*p == '$') {
-                // For dollar sign, we need to escape it differently to avoid warnings
-                fprintf(output, "$");
-            } else {
-                fprintf(output, "%c", *p);
+    if (solve_board(board, &options, &result) != 0) {
+        if (max_nodes > 0 && result.stored >= max_nodes) {
+            snprintf(info->problem, sizeof(info->problem), "not solved within %ld positions",
+                     max_nodes);
+        } else {
+            snprintf(info->problem, sizeof(info->problem), "unsolvable");
+        }
+    }
+    solve_result_free(&result);
+}
+
+static void solve_level(LevelInfo* info, Board* board, int parsed, long max_nodes) {
+    SolveOptions options = { SOLVE_PUSHES, max_nodes, 1 };
+    SolveResult result;
+
+    if (info->lurd || parsed != 0) {
+        return;
+    }
+    if (solve_board(board, &options, &result) == 0) {
+        info->lurd = result.lurd;
+        result.lurd = NULL;
+    }
+    solve_result_free(&result);
+}
+
+// Drop a cached solution that does not replay to a solved position with the
+// game's move rule, so the level is solved again
+static void check_solution(LevelInfo* info, Board* board, int parsed, long max_nodes) {
+    StepChange change;
+    const char* move;
+    int dir;
+
+    (void)max_nodes;
+    if (!info->lurd || parsed != 0) {
+        return;
+    }
+    for (move = info->lurd; *move; move++) {
+        dir = board_dir_from_char(*move);
+        if (dir < 0 || engine_step(board, dir, &change) < 0) {
+            break;
+        }
+    }
+    if (*move || board->boxes_on_goal != board->boxes_total) {
+        free(info->lurd);
+        info->lurd = NULL;
+    }
+}
+
+// FNV-1a hash of a level's text
+static uint64_t level_hash(const char* text) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for (; *text; text++) {
+        hash = (hash ^ (unsigned char)*text) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// Take the solutions of unchanged levels from the cache; returns how many
+static int load_cache(const char* path, Embedder* e) {
+    FILE* input;
+    char* line = NULL;
+    size_t size = 0;
+    ssize_t len;
+    unsigned long long hash;
+    int found = 0, i;
+
+    for (i = 0; i < e->count; i++) {
+        e->info[i].hash = level_hash(e->info[i].map);
+    }
+    input = fopen(path, "r");
+    if (!input) {
+        return 0;
+    }
+    // One "hash LURD" line per level; lines can be any length
+    while ((len = getline(&line, &size, input)) > 0) {
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+            line[--len] = '\0';
+        }
+        if (len < 18 || sscanf(line, "%16llx", &hash) != 1 || line[16] != ' ') {
+            continue;
+        }
+        for (i = 0; i < e->count; i++) {
+            if (!e->info[i].lurd && e->info[i].hash == hash) {
+                e->info[i].lurd = strdup(line + 17);
+                found++;
             }
-            p++;
         }
+    }
+    free(line);
+    fclose(input);
+    return found;
+}
 
-        // Add newline escape sequence
-        fprintf(output, "\\n");
+// Save the solutions of the current levels for the next build
+static int save_cache(const char* path, const Embedder* e) {
+    FILE* output;
+    int i;
+
+    output = fopen(path, "w");
+    if (!output) {
+        return -1;
     }
+    for (i = 0; i < e->count; i++) {
+        if (e->info[i].lurd) {
+            fprintf(output, "%016llx %s\n", (unsigned long long)e->info[i].hash,
+                    e->info[i].lurd);
+        }
+    }
+    return fclose(output);
+}
 
-    // End the string and close the level entry
-    if (is_last) {
-        fprintf(output, "\"\n    }\n");
-    } else {
-        fprintf(output, "\"\n    },\n");
+// Longest solution the level table can hold
+#define MAX_SOLUTION_MOVES 65535
+
+// Write a solution packed four moves to a byte; returns the move count, 0
+// if there is none or it is too long for the table
+static int write_solution(FILE* output, int index, const char* lurd) {
+    int moves = lurd ? (int)strlen(lurd) : 0;
+    int i, byte = 0;
+
+    if (moves == 0 || moves > MAX_SOLUTION_MOVES) {
+        return 0;
+    }
+    fprintf(output, "static const unsigned char level%d_solution[] = {", index);
+    for (i = 0; i < moves; i++) {
+        byte |= board_dir_from_char(lurd[i]) << ((i & 3) * 2);
+        if ((i & 3) == 3 || i == moves - 1) {
+            fprintf(output, "%s0x%02x", i < 4 ? " " : ", ", byte);
+            byte = 0;
+        }
+    }
+    fprintf(output, " };\n");
+    return moves;
+}
+
+// Sort level indices by score, keeping the file order for ties
+static const LevelInfo* sort_info;
+
+static int compare_difficulty(const void* a, const void* b) {
+    double sa = sort_info[*(const int*)a].difficulty.score;
+    double sb = sort_info[*(const int*)b].difficulty.score;
+
+    if (sa != sb) {
+        return sa < sb ? -1 : 1;
     }
+    return *(const int*)a - *(const int*)b;
+}
 
+// Write the order with each level's metrics, easiest first
+static int write_order(const char* path, const Embedder* e, const int* order) {
+    const Difficulty* d;
+    FILE* output;
+    int i;
+
+    output = fopen(path, "w");
+    if (!output) {
+        return -1;
+    }
+    fprintf(output, "# Level order written by embed_levels --order, easiest first.\n");
+    fprintf(output, "# Levels not listed follow in file order. Columns after the name:\n");
+    fprintf(output, "# score pushes moves expanded branching dead-squares boxes\n");
+    for (i = 0; i < e->count; i++) {
+        d = &e->info[order[i]].difficulty;
+        fprintf(output, "%s\t%.1f\t%d\t%d\t%ld\t%.2f\t%d\t%d\n", e->info[order[i]].name,
+                d->solved ? d->score : -1.0, d->pushes, d->moves, d->expanded, d->branching,
+                d->dead_squares, d->boxes);
+    }
+    return fclose(output);
+}
+
+// Put the levels named in an order file first, in its order; returns the
+// number of names found, -1 if there is no file
+static int read_order(const char* path, const Embedder* e, int* order) {
+    char line[MAX_PATH];
+    char* end;
+    FILE* input;
+    int placed = 0, i;
+
+    input = fopen(path, "r");
+    if (!input) {
+        return -1;
+    }
+    while (fgets(line, sizeof(line), input)) {
+        end = line + strcspn(line, "\t\r\n");
+        *end = '\0';
+        if (line[0] == '#' || line[0] == '\0') {
+            continue;
+        }
+        for (i = 0; i < e->count; i++) {
+            if (order[i] >= 0 && strcmp(e->info[i].name, line) == 0) {
+                break;
+            }
+        }
+        if (i == e->count) {
+            fprintf(stderr, "Warning: %s: no level named %s\n", path, line);
+            continue;
+        }
+        // order[] starts as the identity; mark placed levels as -1 - slot
+        order[i] = -1 - placed++;
+    }
     fclose(input);
+    return placed;
+}
+
+// Check every level of the files in parallel and report; returns the
+// number of bad levels, or -1 if the files could not be read
+static int validate_files(char** files, int count, int threads, long max_nodes) {
+    Embedder embedder;
+    struct timespec start, end;
+    int bad = 0, i;
+
+    memset(&embedder, 0, sizeof(embedder));
+    embedder.validate = 1;
+    for (i = 0; i < count; i++) {
+        if (process_level_file(&embedder, files[i]) != 0) {
+            embedder.failed = 1;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for_each_level(&embedder, validate_level, threads, max_nodes);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    for (i = 0; i < embedder.count; i++) {
+        if (embedder.info[i].problem[0]) {
+            fprintf(stderr, "Error: %s: %s\n", embedder.info[i].name, embedder.info[i].problem);
+            bad++;
+        }
+        free(embedder.info[i].map);
+    }
+    printf("Validated %d levels on %d thread%s in %.2f s: %d bad\n", embedder.count, threads,
+           threads == 1 ? "" : "s",
+           (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9, bad);
+    free(embedder.info);
+    return embedder.failed ? -1 : bad;
 }
 
 // Function to sort file names
@@ -79,17 +555,58 @@ int compare_strings(const void* a, const void* b) {
     return strcmp(*(const char**)a, *(const char**)b);
 }
 
-int main(void) {
+int main(int argc, char* argv[]) {
     DIR* dir;
     struct dirent* entry;
     FILE* output;
     char level_dir[] = "levels";
     char output_file[] = "embedded_levels.h";
+    char order_file[] = "levels/order.txt";
     char full_path[MAX_PATH];
     char** file_list = NULL;
+    Embedder embedder;
+    int* order = NULL;
+    int* placed = NULL;
     int file_count = 0;
     int file_capacity = 10;
-    int i;
+    int reorder = 0;
+    int validate = 0;
+    int solutions = 0;
+    int cached;
+    int* moves = NULL;
+    int threads = 0;
+    long max_nodes = DEFAULT_MAX_NODES;
+    int i, n;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--order") == 0) {
+            reorder = 1;
+        } else if (strcmp(argv[i], "--validate") == 0) {
+            validate = 1;
+        } else if (strcmp(argv[i], "--solutions") == 0) {
+            solutions = 1;
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-nodes") == 0 && i + 1 < argc) {
+            max_nodes = atol(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--order | --validate] [--solutions] [-j THREADS] "
+                    "[--max-nodes N]\n", argv[0]);
+            fprintf(stderr, "  --order     Solve every level, sort the table by difficulty and\n");
+            fprintf(stderr, "              save the order to %s\n", order_file);
+            fprintf(stderr, "  --validate  Check every level (one player, boxes = goals, enclosed,\n");
+            fprintf(stderr, "              boxes reachable, solvable) without writing the header\n");
+            fprintf(stderr, "  --solutions Embed a push-optimal solution per level, reusing the\n");
+            fprintf(stderr, "              ones in %s for unchanged levels\n", SOLUTION_CACHE);
+            return 1;
+        }
+    }
+    if (threads <= 0) {
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
 
     // Open the levels directory
     dir = opendir(level_dir);
@@ -106,11 +623,12 @@ int main(void) {
         return 1;
     }
 
-    // Read all .sok files in the directory
+    // Read all .sok and .slc files in the directory
     while ((entry = readdir(dir)) != NULL) {
         size_t name_len = strlen(entry->d_name);
 
-        if (name_len > 4 && strcmp(entry->d_name + name_len - 4, ".sok") == 0) {
+        if (name_len > 4 && (strcmp(entry->d_name + name_len - 4, ".sok") == 0 ||
+                             strcmp(entry->d_name + name_len - 4, ".slc") == 0)) {
             // Resize file list if needed
             if (file_count >= file_capacity) {
                 file_capacity *= 2;
@@ -143,9 +661,9 @@ int main(void) {
 
     closedir(dir);
 
-    // Check if any .sok files were found
+    // Check if any level files were found
     if (file_count == 0) {
-        fprintf(stderr, "Error: No .sok files found in '%s'\n", level_dir);
+        fprintf(stderr, "Error: No .sok or .slc files found in '%s'\n", level_dir);
         free(file_list);
         return 1;
     }
@@ -153,6 +671,15 @@ int main(void) {
     // Sort the file list
     qsort(file_list, file_count, sizeof(char*), compare_strings);
 
+    if (validate) {
+        n = validate_files(file_list, file_count, threads, max_nodes);
+        for (i = 0; i < file_count; i++) {
+            free(file_list[i]);
+        }
+        free(file_list);
+        return n == 0 ? 0 : 1;
+    }
+
     // Open the output file
     output = fopen(output_file, "w");
     if (!output) {
@@ -167,31 +694,154 @@ int main(void) {
     // Write the header file header
     fprintf(output, "#ifndef EMBEDDED_LEVELS_H\n");
     fprintf(output, "#define EMBEDDED_LEVELS_H\n\n");
-    fprintf(output, "/* Auto-generated file containing embedded Sokoban levels */\n\n");
-    fprintf(output, "/* Level data structure */\n");
-    fprintf(output, "typedef struct {\n");
-    fprintf(output, "    const char* name;\n");
-    fprintf(output, "    const char* data;\n");
-    fprintf(output, "} EmbeddedLevel;\n\n");
-    fprintf(output, "/* Array of embedded levels */\n");
-    fprintf(output, "static const EmbeddedLevel embedded_levels[] = {\n");
+    fprintf(output, "/* Auto-generated file containing pre-parsed Sokoban levels */\n\n");
+    fprintf(output, "#include \"levels.h\"\n\n");
 
-    // Process each .sok file
+    // Process each file into its levels' bitplanes
+    memset(&embedder, 0, sizeof(embedder));
+    embedder.output = output;
+    embedder.keep_maps = reorder || solutions;
     for (i = 0; i < file_count; i++) {
-        process_level_file(output, file_list[i], i == file_count - 1);
+        if (process_level_file(&embedder, file_list[i]) != 0) {
+            embedder.failed = 1;
+        }
         free(file_list[i]);
     }
+    if (embedder.count == 0) {
+        embedder.failed = 1;
+    }
+
+    // Table order: by measured difficulty, else from the order file, else
+    // the file order
+    order = (int*)malloc((embedder.count + 1) * sizeof(int));
+    placed = (int*)malloc((embedder.count + 1) * sizeof(int));
+    if (!order || !placed) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        embedder.failed = 1;
+    }
+    for (i = 0; !embedder.failed && i < embedder.count; i++) {
+        order[i] = i;
+    }
+    if (!embedder.failed && reorder) {
+        printf("Measuring %d levels on %d thread%s...\n", embedder.count, threads,
+               threads == 1 ? "" : "s");
+        for_each_level(&embedder, measure_level, threads, max_nodes);
+        sort_info = embedder.info;
+        qsort(order, embedder.count, sizeof(int), compare_difficulty);
+        for (i = 0; i < embedder.count; i++) {
+            const Difficulty* d = &embedder.info[order[i]].difficulty;
+
+            printf("%3d %-20s score %6.1f  pushes %3d  moves %4d  expanded %8ld  "
+                   "branching %5.2f  dead %3d  boxes %2d%s\n", i + 1,
+                   embedder.info[order[i]].name, d->score, d->pushes, d->moves, d->expanded,
+                   d->branching, d->dead_squares, d->boxes, d->solved ? "" : "  (unsolved)");
+        }
+        if (write_order(order_file, &embedder, order) != 0) {
+            fprintf(stderr, "Error: Could not write %s\n", order_file);
+            embedder.failed = 1;
+        }
+    } else if (!embedder.failed && (n = read_order(order_file, &embedder, order)) > 0) {
+        // Listed levels by their slot, the rest after them in file order
+        for (i = 0; i < embedder.count; i++) {
+            if (order[i] < 0) {
+                placed[-1 - order[i]] = i;
+            } else {
+                placed[n++] = i;
+            }
+        }
+        memcpy(order, placed, embedder.count * sizeof(int));
+        printf("Ordered levels by %s\n", order_file);
+    }
+
+    // Solve the levels the cache does not know, all cores, then embed
+    moves = (int*)calloc(embedder.count + 1, sizeof(int));
+    if (!moves) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        embedder.failed = 1;
+    }
+    if (!embedder.failed && solutions) {
+        cached = load_cache(SOLUTION_CACHE, &embedder);
+        if (cached > 0) {
+            // Trust no cache entry without replaying it
+            for_each_level(&embedder, check_solution, threads, max_nodes);
+            for (i = 0, n = 0; i < embedder.count; i++) {
+                n += embedder.info[i].lurd != NULL;
+            }
+            if (n < cached) {
+                fprintf(stderr, "Warning: %d solution%s in %s did not solve the level\n",
+                        cached - n, cached - n == 1 ? "" : "s", SOLUTION_CACHE);
+            }
+            cached = n;
+        }
+        if (cached < embedder.count) {
+            printf("Solving %d level%s on %d thread%s...\n", embedder.count - cached,
+                   embedder.count - cached == 1 ? "" : "s", threads, threads == 1 ? "" : "s");
+            for_each_level(&embedder, solve_level, threads, max_nodes);
+        }
+        if (save_cache(SOLUTION_CACHE, &embedder) != 0) {
+            fprintf(stderr, "Warning: Could not write %s\n", SOLUTION_CACHE);
+        }
+        fprintf(output, "/* Solutions */\n");
+        for (i = 0, n = 0; i < embedder.count; i++) {
+            moves[i] = write_solution(output, i, embedder.info[i].lurd);
+            n += moves[i] > 0;
+            if (moves[i] == 0 && embedder.info[i].lurd) {
+                fprintf(stderr, "Warning: %s: solution of %d moves is longer than the %d "
+                        "that can be embedded\n", embedder.info[i].name,
+                        (int)strlen(embedder.info[i].lurd), MAX_SOLUTION_MOVES);
+            } else if (moves[i] == 0) {
+                fprintf(stderr, "Warning: %s: no solution within %ld positions\n",
+                        embedder.info[i].name, max_nodes);
+            }
+        }
+        fprintf(output, "\n");
+        printf("Embedded %d solutions, %d from %s\n", n, cached, SOLUTION_CACHE);
+    }
+
+    // Write the level table
+    fprintf(output, "/* Array of embedded levels */\n");
+    fprintf(output, "static const EmbeddedLevel embedded_levels[] = {\n");
+    for (n = 0; !embedder.failed && n < embedder.count; n++) {
+        i = order[n];
+        fprintf(output, "    { ");
+        write_string(output, embedder.info[i].name);
+        fprintf(output, ", %d, %d, %d, %d, level%d_walls, level%d_goals, "
+                "level%d_floor, level%d_boxes, ",
+                embedder.info[i].width, embedder.info[i].height, embedder.info[i].player,
+                embedder.info[i].boxes, i, i, i, i);
+        if (moves[i]) {
+            fprintf(output, "level%d_solution, %d }", i, moves[i]);
+        } else {
+            fprintf(output, "NULL, 0 }");
+        }
+        fprintf(output, "%s\n", n == embedder.count - 1 ? "" : ",");
+    }
 
     // Write the header file footer
     fprintf(output, "};\n\n");
     fprintf(output, "/* Number of embedded levels */\n");
-    fprintf(output, "#define NUM_EMBEDDED_LEVELS %d\n\n", file_count);
+    fprintf(output, "#define NUM_EMBEDDED_LEVELS %d\n\n", embedder.count);
     fprintf(output, "#endif /* EMBEDDED_LEVELS_H */\n");
 
     fclose(output);
     free(file_list);
+    for (i = 0; i < embedder.count; i++) {
+        free(embedder.info[i].map);
+        free(embedder.info[i].lurd);
+    }
+    free(embedder.info);
+    free(moves);
+    free(order);
+    free(placed);
+
+    // Never leave a half-valid header behind
+    if (embedder.failed) {
+        remove(output_file);
+        fprintf(stderr, "Error: Invalid levels, %s not generated\n", output_file);
+        return 1;
+    }
 
-    printf("Successfully generated %s with %d levels\n", output_file, file_count);
+    printf("Successfully generated %s with %d levels\n", output_file, embedder.count);
 
     return 0;
 }
@@ -0,0 +1,186 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "engine.h"
+#include "import.h"
+
+/* Monotonic clock in seconds, for timing searches */
+double engine_seconds(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Grow an array of size-byte items to hold at least need of them, doubling
+ * from 1024; returns -1 if out of memory, leaving the array as it was */
+int engine_reserve(void** items, long* capacity, long need, size_t size) {
+    long grown = *capacity ? *capacity : 1024;
+    void* p;
+
+    if (need <= *capacity) {
+        return 0;
+    }
+    while (grown < need) {
+        grown *= 2;
+    }
+    p = realloc(*items, grown * size);
+    if (!p) {
+        return -1;
+    }
+    *items = p;
+    *capacity = grown;
+    return 0;
+}
+
+/* The move rule: step in a LURD direction, pushing a box ahead if the cell
+ * behind it is free. Changes only the board and allocates nothing; returns
+ * -1 if blocked, 1 for a push, 0 for a walk */
+int engine_step(Board* board, int dir, StepChange* change) {
+    int from = board->player;
+    int next = from + board->delta[dir];
+    int dest = next + board->delta[dir];
+
+    change->dir = dir;
+    change->pushed = 0;
+    change->count = 0;
+
+    /* The padding ring is wall, so no bounds checks are needed */
+    if (board->cells[next] & CELL_WALL) {
+        return -1;
+    }
+    if (bb_test(board->boxes, next)) {
+        if ((board->cells[dest] & CELL_WALL) || bb_test(board->boxes, dest)) {
+            return -1;
+        }
+
+        /* Push the box, keeping the goal count in step */
+        bb_clear(board->boxes, next);
+        bb_set(board->boxes, dest);
+        board->boxes_on_goal += ((board->cells[dest] & CELL_GOAL) != 0) -
+                                ((board->cells[next] & CELL_GOAL) != 0);
+        change->pushed = 1;
+        change->cells[2] = dest;
+    }
+    board->player = next;
+    change->cells[0] = from;
+    change->cells[1] = next;
+    change->count = 2 + change->pushed;
+    return change->pushed;
+}
+
+/* Where engine_load_file() parses a file's first level */
+typedef struct {
+    Board* board;
+    int status;
+} LevelTarget;
+
+/* Importer callback: parse the level and stop; the title is not kept */
+static int parse_first(void* context, const char* title, const char* map) {
+    LevelTarget* target = (LevelTarget*)context;
+
+    (void)title;
+    target->status = import_playable(map) ? board_parse(target->board, map) : -1;
+    return 1;
+}
+
+/* Parse the first level of a level file (any format the importer reads) */
+int engine_load_file(const char* path, Board* board) {
+    FILE* file;
+    LevelTarget target;
+
+    file = fopen(path, "r");
+    if (!file) {
+        return -1;
+    }
+    target.board = board;
+    target.status = -1;
+    if (import_file(file, parse_first, &target) != 0) {
+        target.status = -1;
+    }
+    fclose(file);
+    return target.status;
+}
+
+/* Play the levels of an embedded table */
+void levels_init(LevelSet* set, const EmbeddedLevel* table, int count) {
+    memset(set, 0, sizeof(*set));
+    set->table = table;
+    set->table_count = count;
+    set->count = count;
+    set->name = "";
+}
+
+/* Play the levels of a pack file instead of the table */
+int levels_open_pack(LevelSet* set, const char* path) {
+    collection_close(&set->pack);
+    if (collection_open(&set->pack, path) != 0) {
+        return -1;
+    }
+    set->count = set->pack.count;
+    set->current = 0;
+    return 0;
+}
+
+/* Index of an embedded level by name, with or without .sok; -1 if none */
+int levels_find(const LevelSet* set, const char* name) {
+    size_t len = strlen(name);
+    int i;
+
+    for (i = 0; i < set->table_count; i++) {
+        if (strcmp(set->table[i].name, name) == 0 ||
+            (strncmp(set->table[i].name, name, len) == 0 &&
+             strcmp(set->table[i].name + len, ".sok") == 0)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Make a level the current one and load it into the board, reusing its
+ * buffer. A level that does not load leaves the board and the current level
+ * as they were */
+int levels_load(LevelSet* set, int index, Board* board) {
+    char title[sizeof(set->title)];
+
+    if (index < 0 || index >= set->count) {
+        return -1;
+    }
+    if (set->pack.count > 0) {
+        if (collection_load(&set->pack, index, board, title, sizeof(title)) != 0) {
+            return -1;
+        }
+        memcpy(set->title, title, sizeof(title));
+        set->name = set->title;
+        set->solution = NULL;
+        set->solution_moves = 0;
+    } else {
+        if (board_load(board, &set->table[index]) != 0) {
+            return -1;
+        }
+        set->name = set->table[index].name;
+        set->solution = set->table[index].solution;
+        set->solution_moves = set->table[index].solution_moves;
+    }
+    set->current = index;
+    return 0;
+}
+
+/* Load an embedded level by name or else the first level of a file, without
+ * changing the current level; safe to call from several threads */
+int levels_load_named(const LevelSet* set, const char* name, Board* board) {
+    int i = levels_find(set, name);
+
+    if (i >= 0) {
+        return board_load(board, &set->table[i]);
+    }
+    return engine_load_file(name, board);
+}
+
+/* Unmap the pack, if any */
+void levels_close(LevelSet* set) {
+    collection_close(&set->pack);
+    set->count = set->table_count;
+}
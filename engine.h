@@ -0,0 +1,41 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include "board.h"
+#include "collection.h"
+
+/* What one step changed: the player's old cell, its new cell and, after a
+ * push, the cell the box went to. A front end redraws exactly these */
+typedef struct {
+    int dir;                /* LURD direction of the step */
+    int pushed;             /* A box moved */
+    int count;              /* Cells changed, 0 if the step was blocked */
+    int cells[3];
+} StepChange;
+
+/* The levels being played: a table of embedded levels or a level pack */
+typedef struct {
+    const EmbeddedLevel* table;
+    int table_count;
+    Collection pack;        /* Given with levels_open_pack(), count 0 otherwise */
+    int count;
+    int current;
+    const char* name;       /* Of the current level */
+    char title[64];         /* Name storage for pack levels */
+    const unsigned char* solution;  /* Embedded solution (see SOLUTION_MOVE), or NULL */
+    int solution_moves;
+} LevelSet;
+
+double engine_seconds(void);
+int engine_reserve(void** items, long* capacity, long need, size_t size);
+int engine_step(Board* board, int dir, StepChange* change);
+int engine_load_file(const char* path, Board* board);
+
+void levels_init(LevelSet* set, const EmbeddedLevel* table, int count);
+int levels_open_pack(LevelSet* set, const char* path);
+int levels_find(const LevelSet* set, const char* name);
+int levels_load(LevelSet* set, int index, Board* board);
+int levels_load_named(const LevelSet* set, const char* name, Board* board);
+void levels_close(LevelSet* set);
+
+#endif /* ENGINE_H */
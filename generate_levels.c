@@ -0,0 +1,710 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "board.h"
+
+#define MAX_PATH 1024
+#define MAX_BOXES 16
+#define MAX_ROOM 60
+
+// Rounds of tries for levels still below their push target
+#define MAX_ROUNDS 8
+
+// Level generator: carves random rooms, then searches backwards from the
+// solved position by pulling boxes. Every position found that way is
+// solvable, and its depth in the breadth-first search is its optimal push
+// count, so the deepest one becomes the level.
+
+// A parameter ramped from min to max over the levels
+typedef struct {
+    int min;
+    int max;
+} Range;
+
+typedef struct {
+    int count;
+    int first;
+    Range width;
+    Range height;
+    Range boxes;
+    Range pushes;
+    int tries;
+    long max_states;
+    uint64_t seed;
+    int threads;
+    const char* dir;
+} Options;
+
+// Best position of one room
+typedef struct {
+    int pushes;
+    int boxes;
+    long states;
+    char* text;
+} Candidate;
+
+// Backward search states: sorted box cells followed by the normalized player
+typedef struct {
+    const Board* board;
+    int boxes;
+    int width;
+    uint16_t* states;
+    uint64_t* hashes;
+    long count;
+    long state_capacity;    // uint16_t slots in states
+    long hash_capacity;     // Entries in hashes; widths differ between searches
+    long max_states;
+    uint32_t* table;
+    long mask;
+} Search;
+
+// One worker's task deque: the owner takes from the tail, thieves from the head
+typedef struct {
+    pthread_mutex_t lock;
+    int* tasks;
+    int head;
+    int tail;
+} Deque;
+
+typedef struct {
+    const Options* options;
+    Candidate* results;     // One per task of the round
+    const int* pending;     // Levels worked on this round
+    int round;
+    Deque* deques;
+    int id;
+    Board board;
+    Search search;
+    long stolen;
+} Worker;
+
+// splitmix64: small, fast and the same on every platform
+static uint64_t next_random(uint64_t* state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static int random_below(uint64_t* state, int n) {
+    return (int)(next_random(state) % (uint64_t)n);
+}
+
+// Value of a ramped parameter for level i of count
+static int ramp(Range range, int i, int count) {
+    if (count < 2) {
+        return range.min;
+    }
+    return range.min + (range.max - range.min) * i / (count - 1);
+}
+
+// Carve a connected room of width x height cells with a random walk and put
+// goals on random floor cells; returns the level text or NULL
+static char* make_room(uint64_t* rng, int width, int height, int boxes) {
+    char grid[MAX_ROOM + 2][MAX_ROOM + 2];
+    int floor = 0, target, steps, x, y, d, i;
+    static const int dx[4] = { -1, 0, 1, 0 };
+    static const int dy[4] = { 0, -1, 0, 1 };
+    char* text;
+    char* out;
+
+    memset(grid, WALL, sizeof(grid));
+    target = width * height * (50 + random_below(rng, 16)) / 100;
+    if (target < boxes * 3 + 2) {
+        return NULL;
+    }
+
+    // Corridors come from the walk keeping its direction half of the time
+    x = 1 + random_below(rng, width);
+    y = 1 + random_below(rng, height);
+    d = random_below(rng, 4);
+    for (steps = 0; floor < target && steps < target * 100; steps++) {
+        if (grid[y][x] == WALL) {
+            grid[y][x] = EMPTY;
+            floor++;
+        }
+        if (random_below(rng, 2)) {
+            d = random_below(rng, 4);
+        }
+        if (x + dx[d] >= 1 && x + dx[d] <= width && y + dy[d] >= 1 && y + dy[d] <= height) {
+            x += dx[d];
+            y += dy[d];
+        }
+    }
+    if (floor < target) {
+        return NULL;
+    }
+
+    // Goals on distinct floor cells, the player anywhere on the floor
+    for (i = 0; i < boxes; i++) {
+        do {
+            x = 1 + random_below(rng, width);
+            y = 1 + random_below(rng, height);
+        } while (grid[y][x] != EMPTY);
+        grid[y][x] = GOAL;
+    }
+    grid[y][x] = PLAYER_ON_GOAL;
+
+    text = (char*)malloc((width + 3) * (height + 2) + 1);
+    if (!text) {
+        return NULL;
+    }
+    out = text;
+    for (y = 0; y < height + 2; y++) {
+        memcpy(out, grid[y], width + 2);
+        out += width + 2;
+        *out++ = '\n';
+    }
+    *out = '\0';
+    return text;
+}
+
+// Drop all states and size the table for a new search
+static int search_reset(Search* s, const Board* board, int boxes, long max_states) {
+    long size = 1024;
+
+    while (size < max_states * 2 && size < (1L << 30)) {
+        size *= 2;
+    }
+    if (s->mask + 1 != size) {
+        free(s->table);
+        s->table = (uint32_t*)malloc(size * sizeof(uint32_t));
+        if (!s->table) {
+            s->mask = -1;
+            return -1;
+        }
+        s->mask = size - 1;
+    }
+    memset(s->table, 0, size * sizeof(uint32_t));
+    s->board = board;
+    s->boxes = boxes;
+    s->width = boxes + 1;
+    s->count = 0;
+    s->max_states = max_states;
+    return 0;
+}
+
+static void search_free(Search* s) {
+    free(s->states);
+    free(s->hashes);
+    free(s->table);
+    memset(s, 0, sizeof(*s));
+}
+
+// Store a state unless already known; returns 1 if new, 0 if seen, -1 if full
+static int search_insert(Search* s, const uint16_t* state, uint64_t hash) {
+    uint16_t* states;
+    uint64_t* hashes;
+    long slot, index, capacity;
+
+    for (slot = hash & s->mask; s->table[slot]; slot = (slot + 1) & s->mask) {
+        index = s->table[slot] - 1;
+        if (s->hashes[index] == hash &&
+            memcmp(&s->states[index * s->width], state, s->width * sizeof(uint16_t)) == 0) {
+            return 0;
+        }
+    }
+    if (s->count >= s->max_states) {
+        return -1;
+    }
+    if ((s->count + 1) * s->width > s->state_capacity) {
+        capacity = s->state_capacity ? s->state_capacity * 2 : 65536;
+        states = (uint16_t*)realloc(s->states, capacity * sizeof(uint16_t));
+        if (!states) {
+            return -1;
+        }
+        s->states = states;
+        s->state_capacity = capacity;
+    }
+    if (s->count + 1 > s->hash_capacity) {
+        capacity = s->hash_capacity ? s->hash_capacity * 2 : 8192;
+        hashes = (uint64_t*)realloc(s->hashes, capacity * sizeof(uint64_t));
+        if (!hashes) {
+            return -1;
+        }
+        s->hashes = hashes;
+        s->hash_capacity = capacity;
+    }
+    memcpy(&s->states[s->count * s->width], state, s->width * sizeof(uint16_t));
+    s->hashes[s->count] = hash;
+    s->table[slot] = (uint32_t)(++s->count);
+    return 1;
+}
+
+// Generate every pull from a state; returns -1 once the store is full
+static int expand_pulls(Search* s, long index) {
+    const Board* b = s->board;
+    uint16_t state[MAX_BOXES + 1], next[MAX_BOXES + 1];
+    uint64_t boxes[BOARD_MAX_WORDS];
+    uint64_t reach[BOARD_MAX_WORDS];
+    uint64_t hash = s->hashes[index];
+    int i, j, d, box, to, back, player, norm;
+
+    memcpy(state, &s->states[index * s->width], s->width * sizeof(uint16_t));
+    player = state[s->boxes];
+    memset(boxes, 0, b->words * sizeof(uint64_t));
+    for (i = 0; i < s->boxes; i++) {
+        bb_set(boxes, state[i]);
+    }
+    board_reach(b, boxes, player, reach);
+
+    // The player stands next to the box and steps back, the box follows
+    for (i = 0; i < s->boxes; i++) {
+        box = state[i];
+        for (d = 0; d < 4; d++) {
+            to = box + b->delta[d];
+            back = to + b->delta[d];
+            if (!bb_test(reach, to) || !(b->cells[back] & CELL_FLOOR) || bb_test(boxes, back)) {
+                continue;
+            }
+
+            bb_clear(boxes, box);
+            bb_set(boxes, to);
+            norm = board_normalize(b, boxes, back);
+            bb_clear(boxes, to);
+            bb_set(boxes, box);
+
+            // Keep the boxes sorted so equal positions compare equal
+            memcpy(next, state, s->width * sizeof(uint16_t));
+            for (j = i; j > 0 && next[j - 1] > to; j--) {
+                next[j] = next[j - 1];
+            }
+            for (; j < s->boxes - 1 && next[j + 1] < to; j++) {
+                next[j] = next[j + 1];
+            }
+            next[j] = (uint16_t)to;
+            next[s->boxes] = (uint16_t)norm;
+
+            if (search_insert(s, next, hash ^ zobrist_box[box] ^ zobrist_box[to] ^
+                              zobrist_player[player] ^ zobrist_player[norm]) < 0) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+// Search backwards from every solved position (boxes on the goals, player
+// in any region) and return the index of a deepest state, with its depth
+static long search_deepest(Search* s, int* depth) {
+    const Board* b = s->board;
+    uint16_t state[MAX_BOXES + 1];
+    uint64_t boxes[BOARD_MAX_WORDS];
+    uint64_t covered[BOARD_MAX_WORDS];
+    uint64_t reach[BOARD_MAX_WORDS];
+    uint64_t hash = 0;
+    long index = 0, layer_end, deepest = 0;
+    int pos, n = 0, i;
+
+    memset(boxes, 0, b->words * sizeof(uint64_t));
+    for (pos = 0; pos < b->size; pos++) {
+        if (b->cells[pos] & CELL_GOAL) {
+            bb_set(boxes, pos);
+            state[n++] = (uint16_t)pos;
+            hash ^= zobrist_box[pos];
+        }
+    }
+
+    memset(covered, 0, b->words * sizeof(uint64_t));
+    for (pos = 0; pos < b->size; pos++) {
+        if (!(b->cells[pos] & CELL_FLOOR) || bb_test(boxes, pos) || bb_test(covered, pos)) {
+            continue;
+        }
+        board_reach(b, boxes, pos, reach);
+        for (i = 0; i < b->words; i++) {
+            covered[i] |= reach[i];
+        }
+        state[n] = (uint16_t)pos;
+        search_insert(s, state, hash ^ zobrist_player[pos]);
+    }
+
+    // Layer by layer, so the first state of the last layer is a deepest one
+    *depth = 0;
+    while (index < s->count) {
+        layer_end = s->count;
+        for (; index < layer_end; index++) {
+            if (expand_pulls(s, index) != 0) {
+                return deepest;
+            }
+        }
+        if (s->count > layer_end) {
+            deepest = layer_end;
+            (*depth)++;
+        }
+    }
+    return deepest;
+}
+
+// Whether a cell is a wall with no floor around it
+static int is_filler(const Board* b, int pos) {
+    int dx, dy;
+
+    if (!(b->cells[pos] & CELL_WALL)) {
+        return 0;
+    }
+    for (dy = -1; dy <= 1; dy++) {
+        for (dx = -1; dx <= 1; dx++) {
+            if (pos + dy * b->stride + dx >= 0 && pos + dy * b->stride + dx < b->size &&
+                (b->cells[pos + dy * b->stride + dx] & CELL_FLOOR)) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+// Write the room with the boxes and player of a state; walls no floor
+// touches are left out where they connect to the outside
+static void place_state(const Board* b, const uint16_t* state, int boxes, char* text) {
+    unsigned char outside[BOARD_MAX_CELLS];
+    int stack[BOARD_MAX_CELLS];
+    int top = 0, x, y, pos, next, d, i;
+    char* out = text;
+    char ch;
+
+    memset(outside, 0, b->size);
+    for (pos = 0; pos < b->size; pos++) {
+        if (b->cells[pos] & CELL_EDGE) {
+            outside[pos] = 1;
+            stack[top++] = pos;
+        }
+    }
+    while (top > 0) {
+        pos = stack[--top];
+        for (d = 0; d < 4; d++) {
+            next = pos + b->delta[d];
+            if (next >= 0 && next < b->size && !outside[next] && is_filler(b, next)) {
+                outside[next] = 1;
+                stack[top++] = next;
+            }
+        }
+    }
+
+    for (y = 0; y < b->height; y++) {
+        for (x = 0; x < b->width; x++) {
+            pos = board_pos(b, x, y);
+            if (b->cells[pos] & CELL_WALL) {
+                ch = outside[pos] ? EMPTY : WALL;
+            } else {
+                ch = (b->cells[pos] & CELL_GOAL) ? GOAL : EMPTY;
+                for (i = 0; i < boxes; i++) {
+                    if (state[i] == pos) {
+                        ch = (ch == GOAL) ? BOX_ON_GOAL : BOX;
+                    }
+                }
+                if (state[boxes] == pos) {
+                    ch = (ch == GOAL) ? PLAYER_ON_GOAL : PLAYER;
+                }
+            }
+            *out++ = ch;
+        }
+        while (out > text && out[-1] == EMPTY) {
+            out--;
+        }
+        *out++ = '\n';
+    }
+    *out = '\0';
+}
+
+// Generate one room for a level and keep its hardest start position
+static void run_task(Worker* w, int task) {
+    const Options* o = w->options;
+    Candidate* c = &w->results[task];
+    int level = w->pending[task / o->tries];
+    int attempt = w->round * o->tries + task % o->tries;
+    int boxes = ramp(o->boxes, level, o->count);
+    uint64_t rng = o->seed * 0x100000001b3ULL ^ ((uint64_t)level << 32 | (uint64_t)attempt);
+    char* room;
+    long deepest;
+
+    // Every task seeds its own generator, so the output does not depend on
+    // which thread ran what
+    next_random(&rng);
+    room = make_room(&rng, ramp(o->width, level, o->count), ramp(o->height, level, o->count),
+                     boxes);
+    if (!room) {
+        return;
+    }
+    if (board_parse(&w->board, room) != 0 ||
+        search_reset(&w->search, &w->board, boxes, o->max_states) != 0) {
+        free(room);
+        return;
+    }
+
+    deepest = search_deepest(&w->search, &c->pushes);
+    c->boxes = boxes;
+    c->states = w->search.count;
+    if (c->pushes > 0) {
+        place_state(&w->board, &w->search.states[deepest * w->search.width], boxes, room);
+        c->text = room;
+    } else {
+        free(room);
+    }
+}
+
+// Take a task from the own deque, else steal one; -1 when none are left
+static int next_task(Worker* w) {
+    Deque* own = &w->deques[w->id];
+    int threads = w->options->threads;
+    int i, task = -1;
+
+    pthread_mutex_lock(&own->lock);
+    if (own->tail > own->head) {
+        task = own->tasks[--own->tail];
+    }
+    pthread_mutex_unlock(&own->lock);
+
+    // Tasks are never added after the start, so empty deques stay empty
+    for (i = 1; task < 0 && i < threads; i++) {
+        Deque* victim = &w->deques[(w->id + i) % threads];
+
+        pthread_mutex_lock(&victim->lock);
+        if (victim->tail > victim->head) {
+            task = victim->tasks[victim->head++];
+            w->stolen++;
+        }
+        pthread_mutex_unlock(&victim->lock);
+    }
+    return task;
+}
+
+static void* worker_main(void* arg) {
+    Worker* w = (Worker*)arg;
+    int task;
+
+    while ((task = next_task(w)) >= 0) {
+        run_task(w, task);
+    }
+    return NULL;
+}
+
+// Parse N or MIN-MAX
+static int parse_range(const char* text, Range* range) {
+    char* end;
+
+    range->min = (int)strtol(text, &end, 10);
+    range->max = range->min;
+    if (*end == '-') {
+        range->max = (int)strtol(end + 1, &end, 10);
+    }
+    return (*end == '\0' && range->min >= 0 && range->max >= range->min) ? 0 : -1;
+}
+
+static void show_help(const char* program_name) {
+    printf("Usage: %s [options]\n\n", program_name);
+    printf("Generate levels/LNN.sok files. Sizes, box counts and push targets take N or\n");
+    printf("MIN-MAX; a range ramps linearly from the first level to the last.\n\n");
+    printf("  -n N            Levels to generate (default 42)\n");
+    printf("  --first N       Number of the first level file (default 1)\n");
+    printf("  -w N[-M]        Room width in cells (default 8-14)\n");
+    printf("  -H N[-M]        Room height in cells (default 5-8)\n");
+    printf("  -b N[-M]        Boxes (default 1-4)\n");
+    printf("  -d N[-M]        Difficulty: least optimal pushes a level must need; levels\n");
+    printf("                  short of it get more rooms, up to %d rounds (default 0)\n",
+           MAX_ROUNDS);
+    printf("  -t N            Rooms tried per level and round, the hardest is kept (default 16)\n");
+    printf("  -m N            States per backward search (default 200000)\n");
+    printf("  -s SEED         Random seed; the same seed gives the same levels (default 1)\n");
+    printf("  -j N            Threads (default 0 = all cores)\n");
+    printf("  -o DIR          Output directory (default levels)\n");
+    printf("  -h, --help      Show this help\n");
+}
+
+int main(int argc, char* argv[]) {
+    Options o = { 42, 1, { 8, 14 }, { 5, 8 }, { 1, 4 }, { 0, 0 }, 16, 200000, 1, 0, "levels" };
+    Candidate* best;
+    Candidate* results;
+    Deque* deques;
+    Worker* workers;
+    pthread_t* tids;
+    struct timespec start, end;
+    char path[MAX_PATH];
+    FILE* output;
+    int* pending;
+    int tasks, count, round, failed = 0, i, j, t;
+    long states = 0, stolen = 0;
+    double seconds;
+
+    for (i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        int bad = 0;
+
+        if (strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0) {
+            show_help(argv[0]);
+            return 0;
+        }
+        if (!value) {
+            bad = 1;
+        } else if (strcmp(arg, "-n") == 0) {
+            o.count = atoi(value);
+        } else if (strcmp(arg, "--first") == 0) {
+            o.first = atoi(value);
+        } else if (strcmp(arg, "-w") == 0) {
+            bad = parse_range(value, &o.width);
+        } else if (strcmp(arg, "-H") == 0) {
+            bad = parse_range(value, &o.height);
+        } else if (strcmp(arg, "-b") == 0) {
+            bad = parse_range(value, &o.boxes);
+        } else if (strcmp(arg, "-d") == 0) {
+            bad = parse_range(value, &o.pushes);
+        } else if (strcmp(arg, "-t") == 0) {
+            o.tries = atoi(value);
+        } else if (strcmp(arg, "-m") == 0) {
+            o.max_states = atol(value);
+        } else if (strcmp(arg, "-s") == 0) {
+            o.seed = strtoull(value, NULL, 10);
+        } else if (strcmp(arg, "-j") == 0) {
+            o.threads = atoi(value);
+        } else if (strcmp(arg, "-o") == 0) {
+            o.dir = value;
+        } else {
+            bad = 1;
+        }
+        if (bad) {
+            fprintf(stderr, "Error: Bad option %s\n", arg);
+            show_help(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+    if (o.count < 1 || o.tries < 1 || o.max_states < 1 || o.boxes.min < 1 ||
+        o.boxes.max > MAX_BOXES || o.width.min < 3 || o.height.min < 3 ||
+        o.width.max > MAX_ROOM || o.height.max > MAX_ROOM) {
+        fprintf(stderr, "Error: Need 1-%d boxes and rooms of 3-%d cells a side\n",
+                MAX_BOXES, MAX_ROOM);
+        return 1;
+    }
+    if (o.threads <= 0) {
+        o.threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (o.threads < 1) {
+        o.threads = 1;
+    }
+
+    best = (Candidate*)calloc(o.count, sizeof(Candidate));
+    pending = (int*)malloc(o.count * sizeof(int));
+    results = (Candidate*)calloc((size_t)o.count * o.tries, sizeof(Candidate));
+    deques = (Deque*)calloc(o.threads, sizeof(Deque));
+    workers = (Worker*)calloc(o.threads, sizeof(Worker));
+    tids = (pthread_t*)calloc(o.threads, sizeof(pthread_t));
+    if (!best || !pending || !results || !deques || !workers || !tids) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return 1;
+    }
+    for (t = 0; t < o.threads; t++) {
+        pthread_mutex_init(&deques[t].lock, NULL);
+        deques[t].tasks = (int*)malloc((o.count * o.tries / o.threads + 1) * sizeof(int));
+        if (!deques[t].tasks) {
+            fprintf(stderr, "Error: Memory allocation failed\n");
+            return 1;
+        }
+        workers[t].options = &o;
+        workers[t].results = results;
+        workers[t].pending = pending;
+        workers[t].deques = deques;
+        workers[t].id = t;
+    }
+    for (i = 0; i < o.count; i++) {
+        pending[i] = i;
+    }
+    count = o.count;
+
+    printf("Generating %d levels (%d rooms each) on %d threads...\n", o.count, o.tries,
+           o.threads);
+    zobrist_init();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (round = 0; round < MAX_ROUNDS && count > 0; round++) {
+        // Every (level, try) pair is a task; deques are dealt round-robin
+        tasks = count * o.tries;
+        memset(results, 0, tasks * sizeof(Candidate));
+        for (t = 0; t < o.threads; t++) {
+            deques[t].head = 0;
+            deques[t].tail = 0;
+        }
+        for (i = 0; i < tasks; i++) {
+            Deque* deque = &deques[i % o.threads];
+
+            deque->tasks[deque->tail++] = i;
+        }
+
+        for (t = 0; t < o.threads; t++) {
+            workers[t].round = round;
+            pthread_create(&tids[t], NULL, worker_main, &workers[t]);
+        }
+        for (t = 0; t < o.threads; t++) {
+            pthread_join(tids[t], NULL);
+        }
+
+        // Keep the hardest room per level, ties going to the earliest try, so
+        // the result is the same on any number of threads
+        for (i = 0; i < tasks; i++) {
+            Candidate* c = &results[i];
+            Candidate* kept = &best[pending[i / o.tries]];
+
+            states += c->states;
+            if (c->text && (!kept->text || c->pushes > kept->pushes)) {
+                free(kept->text);
+                *kept = *c;
+            } else {
+                free(c->text);
+            }
+        }
+        for (i = 0, j = 0; i < count; i++) {
+            if (!best[pending[i]].text ||
+                best[pending[i]].pushes < ramp(o.pushes, pending[i], o.count)) {
+                pending[j++] = pending[i];
+            }
+        }
+        count = j;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    for (i = 0; i < o.count; i++) {
+        snprintf(path, sizeof(path), "%s/L%02d.sok", o.dir, o.first + i);
+        if (!best[i].text) {
+            fprintf(stderr, "Warning: No room worked out for %s\n", path);
+            failed = 1;
+            continue;
+        }
+        if (best[i].pushes < ramp(o.pushes, i, o.count)) {
+            fprintf(stderr, "Warning: %s needs only %d pushes, below the %d asked for\n", path,
+                    best[i].pushes, ramp(o.pushes, i, o.count));
+        }
+
+        output = fopen(path, "w");
+        if (!output || fputs(best[i].text, output) < 0 || fclose(output) != 0) {
+            fprintf(stderr, "Error: Could not write %s\n", path);
+            failed = 1;
+            continue;
+        }
+        printf("%s: %d boxes, %d pushes\n", path, best[i].boxes, best[i].pushes);
+    }
+
+    for (t = 0; t < o.threads; t++) {
+        stolen += workers[t].stolen;
+        board_free(&workers[t].board);
+        search_free(&workers[t].search);
+        pthread_mutex_destroy(&deques[t].lock);
+        free(deques[t].tasks);
+    }
+    printf("%ld states searched in %d rounds, %.2f s, %ld tasks stolen\n", states, round,
+           seconds, stolen);
+
+    for (i = 0; i < o.count; i++) {
+        free(best[i].text);
+    }
+    free(best);
+    free(pending);
+    free(results);
+    free(deques);
+    free(workers);
+    free(tids);
+    return failed;
+}
@@ -0,0 +1,517 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "hint.h"
+#include "deadlock.h"
+#include "engine.h"
+
+/* Weight of the distance estimate against the pushes made: a higher weight
+ * finds a solution sooner, a lower one a shorter solution */
+#define HINT_WEIGHT 2
+
+/* Seconds until the first guess is reported, then between better guesses */
+#define HINT_FIRST  0.03
+#define HINT_UPDATE 0.25
+
+/* Expansions between checks for a newer request and the clock */
+#define HINT_CHECK 64
+
+/* Distance of a cell no box can reach a goal from */
+#define NO_DIST 0xffff
+
+/* A position kept for all the hints of a level */
+struct HintNode {
+    uint64_t hash;
+    int32_t first_edge;     /* Its pushes in the edge list, -1 until expanded */
+    int32_t edge_count;
+    int32_t next_edge;      /* Push on a known solution, -1 if none */
+    int32_t solved_in;      /* Pushes left on that solution, -1 if unknown */
+    int32_t search;         /* Last search that reached it */
+    int32_t closed;         /* Last search that expanded it */
+    int32_t parent;         /* Node and edge it was reached through in that search */
+    int32_t parent_edge;
+    int32_t g;              /* Pushes from that search's root */
+    int32_t h;              /* Sum of the boxes' goal distances */
+    uint16_t player;        /* Normalized player cell */
+};
+
+/* A push from a node: the position it leads to */
+struct HintEdge {
+    int32_t node;
+    uint16_t move;          /* Box cell << 2 | direction */
+};
+
+/* Push distance of every cell to the nearest goal for a lone box: a box
+ * reaches t from s = t - delta[d] if the player fits behind s */
+static void goal_distances(HintEngine* e) {
+    const Board* b = &e->board;
+    int queue[BOARD_MAX_CELLS];
+    int head = 0, tail = 0, pos, from, d;
+
+    for (pos = 0; pos < b->size; pos++) {
+        e->goal_dist[pos] = NO_DIST;
+        if (b->cells[pos] & CELL_GOAL) {
+            e->goal_dist[pos] = 0;
+            queue[tail++] = pos;
+        }
+    }
+    while (head < tail) {
+        pos = queue[head++];
+        for (d = 0; d < 4; d++) {
+            from = pos - b->delta[d];
+            if ((b->cells[from] & CELL_FLOOR) && (b->cells[from - b->delta[d]] & CELL_FLOOR) &&
+                e->goal_dist[from] == NO_DIST) {
+                e->goal_dist[from] = e->goal_dist[pos] + 1;
+                queue[tail++] = from;
+            }
+        }
+    }
+}
+
+/* Forget every position, keeping the allocations */
+static void clear_table(HintEngine* e) {
+    e->count = 0;
+    e->edge_count = 0;
+    if (e->table) {
+        memset(e->table, 0, (e->mask + 1) * sizeof(int32_t));
+    }
+}
+
+/* Double the hash table and reinsert the nodes */
+static int grow_table(HintEngine* e) {
+    long size = e->table ? (e->mask + 1) * 2 : 4096;
+    int32_t* table = (int32_t*)calloc(size, sizeof(int32_t));
+    long i, slot;
+
+    if (!table) {
+        return -1;
+    }
+    for (i = 0; i < e->count; i++) {
+        slot = e->nodes[i].hash & (size - 1);
+        while (table[slot]) {
+            slot = (slot + 1) & (size - 1);
+        }
+        table[slot] = (int32_t)(i + 1);
+    }
+    free(e->table);
+    e->table = table;
+    e->mask = size - 1;
+    return 0;
+}
+
+/* Index of a position, added if new; -1 when the table is full */
+static long find_node(HintEngine* e, const uint64_t* boxes, int player, uint64_t hash, int h) {
+    int words = e->board.words;
+    struct HintNode* node;
+    long slot, index;
+
+    if ((e->count + 1) * 2 > (e->table ? e->mask + 1 : 0) && grow_table(e) != 0) {
+        return -1;
+    }
+    for (slot = hash & e->mask; e->table[slot]; slot = (slot + 1) & e->mask) {
+        index = e->table[slot] - 1;
+        if (e->nodes[index].hash == hash && e->nodes[index].player == player &&
+            memcmp(e->node_boxes + index * words, boxes, words * sizeof(uint64_t)) == 0) {
+            return index;
+        }
+    }
+
+    if (e->count >= HINT_MAX_NODES ||
+        engine_reserve((void**)&e->nodes, &e->capacity, e->count + 1,
+                       sizeof(struct HintNode)) != 0 ||
+        engine_reserve((void**)&e->node_boxes, &e->boxes_capacity, (e->count + 1) * words,
+                       sizeof(uint64_t)) != 0) {
+        return -1;
+    }
+    index = e->count++;
+    node = &e->nodes[index];
+    node->hash = hash;
+    node->first_edge = -1;
+    node->edge_count = 0;
+    node->next_edge = -1;
+    node->solved_in = -1;
+    node->search = -1;
+    node->closed = -1;
+    node->parent = -1;
+    node->parent_edge = -1;
+    node->g = 0;
+    node->h = h;
+    node->player = (uint16_t)player;
+    memcpy(e->node_boxes + index * words, boxes, words * sizeof(uint64_t));
+    e->table[slot] = (int32_t)(index + 1);
+    return index;
+}
+
+/* Store the pushes from a node that do not deadlock; -1 when full */
+static int expand(HintEngine* e, long index) {
+    const Board* b = &e->board;
+    int words = b->words;
+    uint64_t boxes[BOARD_MAX_WORDS];
+    uint64_t reach[BOARD_MAX_WORDS];
+    uint64_t hash = e->nodes[index].hash, word;
+    int player = e->nodes[index].player;
+    int h = e->nodes[index].h;
+    int i, d, box, dest, norm;
+    long first = e->edge_count, child;
+
+    memcpy(boxes, e->node_boxes + index * words, words * sizeof(uint64_t));
+    board_reach(b, boxes, player, reach);
+    for (i = 0; i < words; i++) {
+        for (word = e->node_boxes[index * words + i]; word; word &= word - 1) {
+            box = i * 64 + __builtin_ctzll(word);
+            for (d = 0; d < 4; d++) {
+                dest = box + b->delta[d];
+                if (!bb_test(reach, box - b->delta[d]) || !(b->cells[dest] & CELL_FLOOR) ||
+                    bb_test(boxes, dest)) {
+                    continue;
+                }
+                bb_clear(boxes, box);
+                bb_set(boxes, dest);
+                child = -2;
+                if (!deadlock_after_push(b, boxes, dest)) {
+                    norm = board_normalize(b, boxes, box);
+                    child = find_node(e, boxes, norm,
+                                      hash ^ zobrist_box[box] ^ zobrist_box[dest] ^
+                                      zobrist_player[player] ^ zobrist_player[norm],
+                                      h - e->goal_dist[box] + e->goal_dist[dest]);
+                }
+                bb_clear(boxes, dest);
+                bb_set(boxes, box);
+                if (child == -1 || (child >= 0 &&
+                    engine_reserve((void**)&e->edges, &e->edge_capacity, e->edge_count + 1,
+                                   sizeof(struct HintEdge)) != 0)) {
+                    e->edge_count = first;
+                    return -1;
+                }
+                if (child >= 0) {
+                    e->edges[e->edge_count].node = (int32_t)child;
+                    e->edges[e->edge_count].move = (uint16_t)(box << 2 | d);
+                    e->edge_count++;
+                }
+            }
+        }
+    }
+    e->nodes[index].first_edge = (int32_t)first;
+    e->nodes[index].edge_count = (int32_t)(e->edge_count - first);
+    return 0;
+}
+
+static int is_solved(const HintEngine* e, long index) {
+    const uint64_t* boxes = e->node_boxes + index * e->board.words;
+    int i;
+
+    for (i = 0; i < e->board.words; i++) {
+        if (boxes[i] & ~e->goals[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Min-heap of priority << 32 | node */
+static int heap_push(HintEngine* e, uint32_t priority, long node) {
+    uint64_t item = (uint64_t)priority << 32 | (uint32_t)node;
+    long i, parent;
+
+    if (engine_reserve((void**)&e->heap, &e->heap_capacity, e->heap_count + 1, sizeof(uint64_t)) != 0) {
+        return -1;
+    }
+    for (i = e->heap_count++; i > 0 && e->heap[parent = (i - 1) / 2] > item; i = parent) {
+        e->heap[i] = e->heap[parent];
+    }
+    e->heap[i] = item;
+    return 0;
+}
+
+static long heap_pop(HintEngine* e) {
+    uint64_t top = e->heap[0], last = e->heap[--e->heap_count];
+    long i = 0, child;
+
+    while ((child = 2 * i + 1) < e->heap_count) {
+        if (child + 1 < e->heap_count && e->heap[child + 1] < e->heap[child]) {
+            child++;
+        }
+        if (e->heap[child] >= last) {
+            break;
+        }
+        e->heap[i] = e->heap[child];
+        i = child;
+    }
+    e->heap[i] = last;
+    return (long)(top & 0xffffffff);
+}
+
+/* Edge of the root's push on the way to a node of the current search */
+static long first_edge(const HintEngine* e, long root, long index) {
+    while (e->nodes[index].parent != root) {
+        index = e->nodes[index].parent;
+    }
+    return e->nodes[index].parent_edge;
+}
+
+/* A node's solution is known: record it for every node on the way there */
+static void keep_solution(HintEngine* e, long root, long index) {
+    long parent;
+
+    while (index != root) {
+        parent = e->nodes[index].parent;
+        if (e->nodes[parent].solved_in < 0 ||
+            e->nodes[parent].solved_in > e->nodes[index].solved_in + 1) {
+            e->nodes[parent].solved_in = e->nodes[index].solved_in + 1;
+            e->nodes[parent].next_edge = e->nodes[index].parent_edge;
+        }
+        index = parent;
+    }
+}
+
+/* Hand an answer to the game */
+static void post(HintEngine* e, int serial, long edge, int pushes, int done, int unsolvable,
+                 double start) {
+    Hint hint;
+
+    hint.serial = serial;
+    hint.box = edge >= 0 ? e->edges[edge].move >> 2 : -1;
+    hint.dir = edge >= 0 ? e->edges[edge].move & 3 : 0;
+    hint.pushes = pushes;
+    hint.done = done;
+    hint.unsolvable = unsolvable;
+    hint.nodes = e->count;
+    hint.seconds = engine_seconds() - start;
+    pthread_mutex_lock(&e->lock);
+    e->hint = hint;
+    e->fresh = 1;
+    pthread_mutex_unlock(&e->lock);
+}
+
+/* Weighted best-first search for a solution from the position, reporting
+ * the push toward the most promising position seen until one is found */
+static void search(HintEngine* e, int serial, const uint64_t* boxes, int player) {
+    const Board* b = &e->board;
+    double start = engine_seconds(), posted = 0;
+    uint64_t hash = 0;
+    long root, index, child, edge, best = -1, best_posted = -1, expanded = 0;
+    int pos, h = 0, full = 0;
+    struct HintNode* node;
+
+    /* A full table is cleared for the next position rather than mid-search */
+    if (e->count >= HINT_MAX_NODES / 2) {
+        clear_table(e);
+    }
+    for (pos = 0; pos < b->size; pos++) {
+        if (bb_test(boxes, pos)) {
+            hash ^= zobrist_box[pos];
+            h += e->goal_dist[pos];
+        }
+    }
+    player = board_normalize(b, boxes, player);
+    root = find_node(e, boxes, player, hash ^ zobrist_player[player], h);
+    if (root < 0) {
+        post(e, serial, -1, 0, 1, 0, start);
+        return;
+    }
+    if (is_solved(e, root)) {
+        post(e, serial, -1, 0, 1, 0, start);
+        return;
+    }
+
+    e->search++;
+    e->heap_count = 0;
+    e->nodes[root].search = e->search;
+    e->nodes[root].parent = -1;
+    e->nodes[root].g = 0;
+    heap_push(e, 0, root);
+
+    while (e->heap_count > 0) {
+        if (++expanded % HINT_CHECK == 0) {
+            if (atomic_load(&e->serial) != serial) {
+                return;
+            }
+            if (engine_seconds() - start > HINT_SECONDS) {
+                break;
+            }
+        }
+        if (best >= 0 && best != best_posted &&
+            engine_seconds() - start > (best_posted < 0 ? HINT_FIRST : posted + HINT_UPDATE)) {
+            post(e, serial, first_edge(e, root, best), 0, 0, 0, start);
+            best_posted = best;
+            posted = engine_seconds() - start;
+        }
+
+        index = heap_pop(e);
+        node = &e->nodes[index];
+        if (node->closed == e->search) {
+            continue;
+        }
+        node->closed = e->search;
+
+        /* Solved here or known from an earlier hint: done */
+        if (node->solved_in >= 0 || is_solved(e, index)) {
+            if (node->solved_in < 0) {
+                node->solved_in = 0;
+            }
+            keep_solution(e, root, index);
+            post(e, serial, e->nodes[root].next_edge, e->nodes[root].solved_in, 1, 0, start);
+            return;
+        }
+
+        if (node->first_edge < 0 && expand(e, index) != 0) {
+            full = 1;
+            break;
+        }
+        node = &e->nodes[index];
+        for (edge = node->first_edge; edge < node->first_edge + node->edge_count; edge++) {
+            child = e->edges[edge].node;
+            if (e->nodes[child].search == e->search &&
+                (e->nodes[child].closed == e->search || e->nodes[child].g <= node->g + 1)) {
+                continue;
+            }
+            e->nodes[child].search = e->search;
+            e->nodes[child].parent = (int32_t)index;
+            e->nodes[child].parent_edge = (int32_t)edge;
+            e->nodes[child].g = node->g + 1;
+            if (heap_push(e, e->nodes[child].g + HINT_WEIGHT * e->nodes[child].h, child) != 0) {
+                full = 1;
+                break;
+            }
+            if (best < 0 || e->nodes[child].h < e->nodes[best].h) {
+                best = child;
+            }
+        }
+        if (full) {
+            break;
+        }
+    }
+
+    /* Out of time or memory: the best guess; out of positions: no solution */
+    post(e, serial, best >= 0 ? first_edge(e, root, best) : -1, 0, 1,
+         e->heap_count == 0 && !full, start);
+}
+
+/* Worker: search each request until a newer one arrives or it is answered */
+static void* worker(void* arg) {
+    HintEngine* e = (HintEngine*)arg;
+    uint64_t boxes[BOARD_MAX_WORDS];
+    int serial, player;
+
+    pthread_mutex_lock(&e->lock);
+    for (;;) {
+        while (!e->quit && e->taken == atomic_load(&e->serial)) {
+            pthread_cond_wait(&e->wake, &e->lock);
+        }
+        if (e->quit) {
+            break;
+        }
+        serial = atomic_load(&e->serial);
+        e->taken = serial;
+        memcpy(boxes, e->request, e->board.words * sizeof(uint64_t));
+        player = e->request_player;
+        pthread_mutex_unlock(&e->lock);
+        search(e, serial, boxes, player);
+        pthread_mutex_lock(&e->lock);
+    }
+    pthread_mutex_unlock(&e->lock);
+    return NULL;
+}
+
+/* Set up an engine with no level and no thread yet */
+void hint_init(HintEngine* engine) {
+    memset(engine, 0, sizeof(*engine));
+    pthread_mutex_init(&engine->lock, NULL);
+    pthread_cond_init(&engine->wake, NULL);
+    atomic_init(&engine->serial, 0);
+}
+
+/* Stop the worker, abandoning its search */
+static void stop(HintEngine* e) {
+    if (!e->started) {
+        return;
+    }
+    pthread_mutex_lock(&e->lock);
+    e->quit = 1;
+    atomic_fetch_add(&e->serial, 1);
+    pthread_cond_signal(&e->wake);
+    pthread_mutex_unlock(&e->lock);
+    pthread_join(e->thread, NULL);
+    e->started = 0;
+    e->quit = 0;
+    e->taken = atomic_load(&e->serial);
+}
+
+/* Switch to a new level (dead squares marked), forgetting the old one */
+int hint_level(HintEngine* engine, const Board* board) {
+    int pos;
+
+    stop(engine);
+    engine->board = *board;
+    engine->board.cells = engine->cells;
+    engine->board.boxes = NULL;
+    engine->board.open = engine->open;
+    memcpy(engine->cells, board->cells, board->size);
+    memcpy(engine->open, board->open, board->words * sizeof(uint64_t));
+    memset(engine->goals, 0, sizeof(engine->goals));
+    for (pos = 0; pos < board->size; pos++) {
+        if (board->cells[pos] & CELL_GOAL) {
+            bb_set(engine->goals, pos);
+        }
+    }
+    goal_distances(engine);
+    clear_table(engine);
+    engine->fresh = 0;
+    return 0;
+}
+
+/* Ask for a hint for the board's position; returns the request's serial */
+int hint_request(HintEngine* engine, const Board* board) {
+    int serial;
+
+    pthread_mutex_lock(&engine->lock);
+    memcpy(engine->request, board->boxes, board->words * sizeof(uint64_t));
+    engine->request_player = board->player;
+    serial = atomic_fetch_add(&engine->serial, 1) + 1;
+    engine->fresh = 0;
+    pthread_cond_signal(&engine->wake);
+    pthread_mutex_unlock(&engine->lock);
+
+    if (!engine->started) {
+        if (pthread_create(&engine->thread, NULL, worker, engine) != 0) {
+            return -1;
+        }
+        engine->started = 1;
+    }
+    return serial;
+}
+
+/* Abandon the current request, leaving the worker idle until the next one */
+void hint_cancel(HintEngine* engine) {
+    pthread_mutex_lock(&engine->lock);
+    engine->taken = atomic_fetch_add(&engine->serial, 1) + 1;
+    engine->fresh = 0;
+    pthread_mutex_unlock(&engine->lock);
+}
+
+/* Collect the latest answer; returns 1 if there is one not seen before */
+int hint_poll(HintEngine* engine, Hint* hint) {
+    int fresh;
+
+    pthread_mutex_lock(&engine->lock);
+    fresh = engine->fresh;
+    if (fresh) {
+        *hint = engine->hint;
+        engine->fresh = 0;
+    }
+    pthread_mutex_unlock(&engine->lock);
+    return fresh;
+}
+
+/* Stop the worker and free the table */
+void hint_free(HintEngine* engine) {
+    stop(engine);
+    free(engine->nodes);
+    free(engine->node_boxes);
+    free(engine->table);
+    free(engine->edges);
+    free(engine->heap);
+    pthread_mutex_destroy(&engine->lock);
+    pthread_cond_destroy(&engine->wake);
+    memset(engine, 0, sizeof(*engine));
+}
@@ -0,0 +1,78 @@
+#ifndef HINT_H
+#define HINT_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "board.h"
+
+/* Seconds a hint search may run before it settles for its best guess */
+#define HINT_SECONDS 10.0
+
+/* Positions kept between the hints of a level before starting over */
+#define HINT_MAX_NODES (1 << 21)
+
+/* The push suggested for a position */
+typedef struct {
+    int serial;             /* Request it answers */
+    int box;                /* Box to push, -1 if none */
+    int dir;                /* Direction to push it (LURD) */
+    int pushes;             /* Pushes left on a solution through it, 0 while unproven */
+    int done;               /* No better answer follows for this request */
+    int unsolvable;         /* The search proved there is no solution */
+    long nodes;             /* Positions known to the engine */
+    double seconds;         /* Since the request */
+} Hint;
+
+struct HintNode;
+struct HintEdge;
+
+/* Anytime push search on a worker thread. Positions and the pushes between
+ * them stay in a transposition table across requests, so a hint after
+ * following the last one is usually answered from the table */
+typedef struct {
+    /* Level, a private copy so the worker never reads the game's board */
+    Board board;
+    unsigned char cells[BOARD_MAX_CELLS];
+    uint64_t open[BOARD_MAX_WORDS];
+    uint64_t goals[BOARD_MAX_WORDS];
+    unsigned short goal_dist[BOARD_MAX_CELLS];  /* Pushes to the nearest goal, alone */
+
+    /* Transposition table: worker only */
+    struct HintNode* nodes;
+    uint64_t* node_boxes;   /* Box bitboard per node */
+    long boxes_capacity;
+    long count;
+    long capacity;
+    int32_t* table;         /* Open addressing, node index + 1 */
+    long mask;
+    struct HintEdge* edges;
+    long edge_count;
+    long edge_capacity;
+    uint64_t* heap;         /* Open list: priority << 32 | node */
+    long heap_count;
+    long heap_capacity;
+    int search;
+
+    /* Worker and its mailbox, guarded by lock */
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    int started;
+    int quit;
+    atomic_int serial;      /* Latest request; a search stops once it changes */
+    int taken;              /* Request the worker last started on or was cancelled */
+    uint64_t request[BOARD_MAX_WORDS];
+    int request_player;
+    Hint hint;              /* Latest answer */
+    int fresh;              /* Set until hint_poll() collects it */
+} HintEngine;
+
+void hint_init(HintEngine* engine);
+int hint_level(HintEngine* engine, const Board* board);
+int hint_request(HintEngine* engine, const Board* board);
+void hint_cancel(HintEngine* engine);
+int hint_poll(HintEngine* engine, Hint* hint);
+void hint_free(HintEngine* engine);
+
+#endif /* HINT_H */
@@ -0,0 +1,160 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "history.h"
+
+/* Replay a recorded move; it was legal when recorded so no checks */
+static void apply_move(Board* board, int move) {
+    int delta = board->delta[MOVE_DIR(move)];
+    int next = board->player + delta;
+
+    if (move & MOVE_PUSH) {
+        bb_clear(board->boxes, next);
+        bb_set(board->boxes, next + delta);
+        board->boxes_on_goal += ((board->cells[next + delta] & CELL_GOAL) != 0) -
+                                ((board->cells[next] & CELL_GOAL) != 0);
+    }
+    board->player = next;
+}
+
+/* Reverse a recorded move, pulling the box back if it was a push */
+static void unapply_move(Board* board, int move) {
+    int delta = board->delta[MOVE_DIR(move)];
+    int box = board->player + delta;
+
+    if (move & MOVE_PUSH) {
+        bb_clear(board->boxes, box);
+        bb_set(board->boxes, board->player);
+        board->boxes_on_goal += ((board->cells[board->player] & CELL_GOAL) != 0) -
+                                ((board->cells[box] & CELL_GOAL) != 0);
+    }
+    board->player -= delta;
+}
+
+/* Store the board as snapshot index */
+static int save_snapshot(History* history, const Board* board, int index) {
+    int stride = history->words + 1;
+    uint64_t* grown;
+    uint64_t* snap;
+
+    if (index >= history->snapshot_capacity) {
+        history->snapshot_capacity = history->snapshot_capacity ? history->snapshot_capacity * 2 : 8;
+        grown = (uint64_t*)realloc(history->snapshots,
+                                   (size_t)history->snapshot_capacity * stride * sizeof(uint64_t));
+        if (!grown) {
+            return -1;
+        }
+        history->snapshots = grown;
+    }
+    snap = history->snapshots + (size_t)index * stride;
+    memcpy(snap, board->boxes, history->words * sizeof(uint64_t));
+    snap[history->words] = (uint64_t)board->player | (uint64_t)board->boxes_on_goal << 32;
+    history->snapshot_count = index + 1;
+    return 0;
+}
+
+static void load_snapshot(const History* history, Board* board, int index) {
+    const uint64_t* snap = history->snapshots + (size_t)index * (history->words + 1);
+
+    memcpy(board->boxes, snap, history->words * sizeof(uint64_t));
+    board->player = (int)(snap[history->words] & 0xFFFFFFFF);
+    board->boxes_on_goal = (int)(snap[history->words] >> 32);
+}
+
+/* Start an empty history for a freshly loaded board */
+int history_reset(History* history, const Board* board) {
+    history->length = 0;
+    history->cursor = 0;
+    history->snapshot_count = 0;
+    if (history->words != board->words) {
+        /* Snapshot layout changed, start the buffer over */
+        free(history->snapshots);
+        history->snapshots = NULL;
+        history->snapshot_capacity = 0;
+        history->words = board->words;
+    }
+    return save_snapshot(history, board, 0);
+}
+
+/* Append a move already applied to the board, dropping any redo tail */
+int history_record(History* history, const Board* board, int move) {
+    unsigned char* grown;
+
+    if (history->cursor < history->length) {
+        history->length = history->cursor;
+        history->snapshot_count = history->cursor / SNAPSHOT_INTERVAL + 1;
+    }
+    if (history->length == history->capacity) {
+        history->capacity = history->capacity ? history->capacity * 2 : 4096;
+        grown = (unsigned char*)realloc(history->moves, history->capacity);
+        if (!grown) {
+            return -1;
+        }
+        history->moves = grown;
+    }
+
+    history->moves[history->length++] = (unsigned char)move;
+    history->cursor = history->length;
+    if (history->cursor % SNAPSHOT_INTERVAL == 0) {
+        return save_snapshot(history, board, history->cursor / SNAPSHOT_INTERVAL);
+    }
+    return 0;
+}
+
+/* Take back the last applied move, returns it or -1 */
+int history_undo(History* history, Board* board) {
+    int move;
+
+    if (history->cursor == 0) {
+        return -1;
+    }
+    move = history->moves[--history->cursor];
+    unapply_move(board, move);
+    return move;
+}
+
+/* Reapply the next undone move, returns it or -1 */
+int history_redo(History* history, Board* board) {
+    int move;
+
+    if (history->cursor == history->length) {
+        return -1;
+    }
+    move = history->moves[history->cursor++];
+    apply_move(board, move);
+    return move;
+}
+
+/* Jump to any point of the history, via the nearest snapshot when that
+ * is shorter than stepping; returns the new cursor */
+int history_seek(History* history, Board* board, int target) {
+    int snapshot;
+
+    if (target < 0) {
+        target = 0;
+    }
+    if (target > history->length) {
+        target = history->length;
+    }
+
+    snapshot = target / SNAPSHOT_INTERVAL;
+    if (snapshot < history->snapshot_count &&
+        target - snapshot * SNAPSHOT_INTERVAL < abs(target - history->cursor)) {
+        load_snapshot(history, board, snapshot);
+        history->cursor = snapshot * SNAPSHOT_INTERVAL;
+    }
+    while (history->cursor < target) {
+        history_redo(history, board);
+    }
+    while (history->cursor > target) {
+        history_undo(history, board);
+    }
+    return history->cursor;
+}
+
+/* Free the history buffers */
+void history_free(History* history) {
+    free(history->moves);
+    free(history->snapshots);
+    memset(history, 0, sizeof(*history));
+}
@@ -0,0 +1,32 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include "board.h"
+
+/* One byte per move: bits 0-1 direction (LURD), bit 2 set for a push */
+#define MOVE_DIR(m)  ((m) & 3)
+#define MOVE_PUSH    0x04
+
+/* Moves between board snapshots */
+#define SNAPSHOT_INTERVAL 1024
+
+/* Undo/redo log with periodic snapshots for fast seeking */
+typedef struct {
+    unsigned char* moves;   /* Recorded moves, including undone ones */
+    int length;             /* Moves recorded */
+    int cursor;             /* Moves currently applied */
+    int capacity;
+    uint64_t* snapshots;    /* Box bitboard + packed player/goal word per snapshot */
+    int snapshot_count;
+    int snapshot_capacity;
+    int words;              /* Bitboard words per snapshot */
+} History;
+
+int history_reset(History* history, const Board* board);
+int history_record(History* history, const Board* board, int move);
+int history_undo(History* history, Board* board);
+int history_redo(History* history, Board* board);
+int history_seek(History* history, Board* board, int target);
+void history_free(History* history);
+
+#endif /* HISTORY_H */
@@ -0,0 +1,394 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "import.h"
+
+/* Bytes read from a file per import_feed() call */
+#define IMPORT_CHUNK 65536
+
+/* Deepest nesting of RLE groups like 2(#$) */
+#define MAX_GROUP_DEPTH 8
+
+/* Make room for extra more bytes in a growable buffer */
+static int reserve(char** buffer, size_t* capacity, size_t used, size_t extra) {
+    size_t size = *capacity ? *capacity : 256;
+    char* grown;
+
+    if (used + extra <= *capacity) {
+        return 0;
+    }
+    while (size < used + extra) {
+        size *= 2;
+    }
+    grown = (char*)realloc(*buffer, size);
+    if (!grown) {
+        return -1;
+    }
+    *buffer = grown;
+    *capacity = size;
+    return 0;
+}
+
+/* Append count copies of a map character, '-' and '_' being floor */
+static int put_cell(Importer* im, char ch, long count) {
+    if (ch == '-' || ch == '_') {
+        ch = ' ';
+    }
+    if (reserve(&im->map, &im->map_cap, im->map_len, count + 1) != 0) {
+        return -1;
+    }
+    memset(im->map + im->map_len, ch, count);
+    im->map_len += count;
+    return 0;
+}
+
+/* Expand run-length encoded map text into rows: a count applies to the next
+ * character or (group), '|' ends a row */
+static int expand(Importer* im, const char* src, size_t len, int depth) {
+    size_t i = 0, open, end;
+    long count, n;
+    int level;
+
+    while (i < len) {
+        count = 0;
+        while (i < len && src[i] >= '0' && src[i] <= '9') {
+            count = count * 10 + (src[i++] - '0');
+            if (count > 4096) {
+                return -1;
+            }
+        }
+        if (i == len) {
+            break;
+        }
+        if (count == 0) {
+            count = 1;
+        }
+        if (src[i] == '(') {
+            open = i + 1;
+            for (end = open, level = 1; end < len; end++) {
+                if (src[end] == '(') {
+                    level++;
+                } else if (src[end] == ')' && --level == 0) {
+                    break;
+                }
+            }
+            if (end == len || depth >= MAX_GROUP_DEPTH) {
+                return -1;
+            }
+            for (n = 0; n < count; n++) {
+                if (expand(im, src + open, end - open, depth + 1) != 0) {
+                    return -1;
+                }
+            }
+            i = end + 1;
+        } else if (src[i] == '|') {
+            if (put_cell(im, '\n', count) != 0) {
+                return -1;
+            }
+            i++;
+        } else {
+            if (src[i] != '\r' && put_cell(im, src[i], count) != 0) {
+                return -1;
+            }
+            i++;
+        }
+    }
+    return 0;
+}
+
+/* Whether a text line is (run-length encoded) map rows: only map characters,
+ * counts and groups, and at least one wall */
+int import_map_line(const char* line, size_t len) {
+    int walls = 0;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        switch (line[i]) {
+            case '#':
+                walls++;
+                break;
+            case ' ': case '-': case '_': case '@': case '+':
+            case '$': case '*': case '.': case '\r': case '|':
+            case '(': case ')':
+                break;
+            default:
+                if (line[i] < '0' || line[i] > '9') {
+                    return 0;
+                }
+        }
+    }
+    return walls > 0;
+}
+
+/* Whether imported map text can be played: at least one box and as many
+ * boxes as goals. Blocks of map-like lines that fail this are not levels */
+int import_playable(const char* map) {
+    int boxes = 0, goals = 0;
+
+    for (; *map; map++) {
+        boxes += *map == '$' || *map == '*';
+        goals += *map == '.' || *map == '+' || *map == '*';
+    }
+    return boxes > 0 && boxes == goals;
+}
+
+/* Copy text into a title of title_size bytes, dropping a leading comment
+ * mark and blanks and trailing blanks */
+void import_title(char* title, size_t title_size, const char* text, size_t len) {
+    while (len > 0 && (*text == ';' || *text == ' ' || *text == '\t')) {
+        text++;
+        len--;
+    }
+    while (len > 0 && (text[len - 1] == '\r' || text[len - 1] == ' ')) {
+        len--;
+    }
+    if (len >= title_size) {
+        len = title_size - 1;
+    }
+    memcpy(title, text, len);
+    title[len] = '\0';
+}
+
+/* Hand the level read so far to the callback and start a new one */
+static void emit_level(Importer* im) {
+    if (im->map_len > 0 && !im->stopped) {
+        im->map[im->map_len] = '\0';
+        if (im->emit(im->context, im->title, im->map) != 0) {
+            im->stopped = 1;
+        }
+    }
+    im->map_len = 0;
+    im->map_done = 0;
+    im->title[0] = '\0';
+}
+
+/* Text: one complete line; maps are runs of map lines, titled by a
+ * "Title:" line after the map or else the line right before it */
+static int text_line(Importer* im, const char* line, size_t len) {
+    if (import_map_line(line, len)) {
+        if (im->map_done) {
+            emit_level(im);
+        }
+        if (im->map_len == 0) {
+            memcpy(im->title, im->before, IMPORT_TITLE);
+        }
+        if (expand(im, line, len, 0) != 0 || put_cell(im, '\n', 1) != 0) {
+            return -1;
+        }
+        im->before[0] = '\0';
+        return 0;
+    }
+
+    if (im->map_len > 0) {
+        im->map_done = 1;
+        if (len > 6 && strncmp(line, "Title:", 6) == 0) {
+            import_title(im->title, IMPORT_TITLE, line + 6, len - 6);
+        }
+    }
+    import_title(im->before, IMPORT_TITLE, line, len);
+    return 0;
+}
+
+/* Decode the few XML entities a level name may contain */
+static void unescape(char* text) {
+    static const char* names[] = { "&amp;", "&lt;", "&gt;", "&quot;", "&apos;" };
+    static const char chars[] = "&<>\"'";
+    char *in = text, *out = text;
+    int i;
+
+    while (*in) {
+        for (i = 0; i < 5; i++) {
+            if (strncmp(in, names[i], strlen(names[i])) == 0) {
+                break;
+            }
+        }
+        if (i < 5) {
+            *out++ = chars[i];
+            in += strlen(names[i]);
+        } else {
+            *out++ = *in++;
+        }
+    }
+    *out = '\0';
+}
+
+/* Whether a tag's name is exactly name */
+static int tag_is(const char* tag, const char* name) {
+    size_t len = strlen(name);
+
+    return strncmp(tag, name, len) == 0 &&
+           (tag[len] == '\0' || tag[len] == ' ' || tag[len] == '/' ||
+            tag[len] == '\t' || tag[len] == '\r' || tag[len] == '\n');
+}
+
+/* SLC: one complete tag, without the angle brackets */
+static int xml_tag(Importer* im, char* tag, size_t len) {
+    const char* id;
+    const char* end;
+    char quote;
+
+    if (tag_is(tag, "Level")) {
+        im->map_len = 0;
+        im->title[0] = '\0';
+        id = strstr(tag, "Id=");
+        if (id && (id[3] == '"' || id[3] == '\'')) {
+            quote = id[3];
+            id += 4;
+            end = strchr(id, quote);
+            if (end) {
+                import_title(im->title, IMPORT_TITLE, id, end - id);
+                unescape(im->title);
+            }
+        }
+    } else if (tag_is(tag, "/Level")) {
+        emit_level(im);
+    } else if (tag_is(tag, "L")) {
+        if (len > 0 && tag[len - 1] == '/') {
+            return put_cell(im, '\n', 1);
+        }
+        im->in_row = 1;
+    } else if (tag_is(tag, "/L")) {
+        im->in_row = 0;
+        return put_cell(im, '\n', 1);
+    }
+    return 0;
+}
+
+/* SLC: one byte of the document */
+static int xml_byte(Importer* im, char ch) {
+    if (im->in_tag) {
+        if (ch == '>') {
+            /* A comment only ends at "-->" */
+            if (im->line_len >= 3 && strncmp(im->line, "!--", 3) == 0 &&
+                (im->line_len < 5 || strncmp(im->line + im->line_len - 2, "--", 2) != 0)) {
+                im->line[im->line_len++] = ch;
+                return 0;
+            }
+            im->line[im->line_len] = '\0';
+            im->in_tag = 0;
+            return xml_tag(im, im->line, im->line_len);
+        }
+        im->line[im->line_len++] = ch;
+        return 0;
+    }
+    if (ch == '<') {
+        im->in_tag = 1;
+        im->line_len = 0;
+    } else if (im->in_row && ch != '\r' && ch != '\n') {
+        return put_cell(im, ch, 1);
+    }
+    return 0;
+}
+
+/* Start a parse that reports every level to emit */
+void import_init(Importer* im, ImportLevel emit, void* context) {
+    memset(im, 0, sizeof(*im));
+    im->emit = emit;
+    im->context = context;
+}
+
+/* Parse the next chunk of input; returns -1 on error, 1 once the callback
+ * asked to stop, 0 otherwise. Only the current line and level are kept */
+int import_feed(Importer* im, const char* data, size_t len) {
+    const char* nl;
+    size_t i, n;
+
+    if (im->stopped) {
+        return 1;
+    }
+
+    if (im->format == IMPORT_UNKNOWN) {
+        /* Skip leading blank lines and a UTF-8 byte order mark, but keep the
+         * blanks starting the first line: they may indent a map row */
+        for (i = 0; i < len && data[i] && strchr(" \t\r\n\xEF\xBB\xBF", data[i]); i++) {
+            if (data[i] == '\n' || (unsigned char)data[i] >= 0x80) {
+                im->line_len = 0;
+            } else if (reserve(&im->line, &im->line_cap, im->line_len, 1) == 0) {
+                im->line[im->line_len++] = data[i];
+            } else {
+                return -1;
+            }
+        }
+        data += i;
+        len -= i;
+        if (len == 0) {
+            return 0;
+        }
+        if (*data == '<') {
+            im->format = IMPORT_SLC;
+            im->line_len = 0;
+        } else {
+            im->format = IMPORT_TEXT;
+        }
+    }
+
+    if (im->format == IMPORT_SLC) {
+        for (i = 0; i < len && !im->stopped; i++) {
+            if (reserve(&im->line, &im->line_cap, im->line_len, 2) != 0 ||
+                xml_byte(im, data[i]) != 0) {
+                return -1;
+            }
+        }
+        return im->stopped;
+    }
+
+    while (len > 0 && !im->stopped) {
+        nl = memchr(data, '\n', len);
+        n = nl ? (size_t)(nl - data) : len;
+        if (reserve(&im->line, &im->line_cap, im->line_len, n + 1) != 0) {
+            return -1;
+        }
+        memcpy(im->line + im->line_len, data, n);
+        im->line_len += n;
+        if (!nl) {
+            break;
+        }
+        if (text_line(im, im->line, im->line_len) != 0) {
+            return -1;
+        }
+        im->line_len = 0;
+        data += n + 1;
+        len -= n + 1;
+    }
+    return im->stopped;
+}
+
+/* End of input: report the last level and free the buffers */
+int import_finish(Importer* im) {
+    int status = 0;
+
+    if (im->format == IMPORT_TEXT && im->line_len > 0 && !im->stopped) {
+        status = text_line(im, im->line, im->line_len);
+    }
+    if (im->format == IMPORT_TEXT && status == 0) {
+        emit_level(im);
+    }
+    free(im->line);
+    free(im->map);
+    im->line = NULL;
+    im->map = NULL;
+    return status;
+}
+
+/* Parse a whole file in fixed-size chunks */
+int import_file(FILE* input, ImportLevel emit, void* context) {
+    Importer im;
+    char* chunk;
+    size_t n;
+    int status = 0;
+
+    chunk = (char*)malloc(IMPORT_CHUNK);
+    if (!chunk) {
+        return -1;
+    }
+    import_init(&im, emit, context);
+    while (status == 0 && (n = fread(chunk, 1, IMPORT_CHUNK, input)) > 0) {
+        status = import_feed(&im, chunk, n);
+    }
+    free(chunk);
+    if (status < 0) {
+        import_finish(&im);
+        return -1;
+    }
+    return import_finish(&im);
+}
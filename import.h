@@ -0,0 +1,46 @@
+#ifndef IMPORT_H
+#define IMPORT_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/* Longest level title kept */
+#define IMPORT_TITLE 64
+
+/* Input formats, detected from the first non-blank character */
+#define IMPORT_UNKNOWN  0
+#define IMPORT_TEXT     1   /* XSB text, rows optionally run-length encoded */
+#define IMPORT_SLC      2   /* SokobanYASC XML collection */
+
+/* Called for every complete level with its title (empty if none) and its
+ * rows as plain XSB text; a non-zero return stops the import */
+typedef int (*ImportLevel)(void* context, const char* title, const char* map);
+
+/* Push parser state: feed it the input in chunks of any size */
+typedef struct {
+    ImportLevel emit;
+    void* context;
+    int format;
+    int stopped;
+    char* line;             /* Text line or XML tag being read */
+    size_t line_len;
+    size_t line_cap;
+    char* map;              /* Rows of the current level */
+    size_t map_len;
+    size_t map_cap;
+    int map_done;           /* Text: the map has ended, waiting for its title */
+    int in_tag;             /* XML: inside <...> */
+    int in_row;             /* XML: inside <L>...</L> */
+    char title[IMPORT_TITLE];
+    char before[IMPORT_TITLE];  /* Text: last line that was not part of a map */
+} Importer;
+
+void import_init(Importer* importer, ImportLevel emit, void* context);
+int import_feed(Importer* importer, const char* data, size_t len);
+int import_finish(Importer* importer);
+int import_map_line(const char* line, size_t len);
+int import_playable(const char* map);
+void import_title(char* title, size_t title_size, const char* text, size_t len);
+int import_file(FILE* input, ImportLevel emit, void* context);
+
+#endif /* IMPORT_H */
@@ -10,4 +10,25 @@
 #define PLAYER_ON_GOAL '+'
 #define GOAL '.'
 
+#include <stdint.h>
+
+/* Pre-parsed level emitted by embed_levels. Bitplanes cover the padded
+ * board (a wall ring around the level), one bit per cell, LSB first. */
+typedef struct {
+    const char* name;
+    unsigned short width;       /* Level size without padding */
+    unsigned short height;
+    unsigned short player;      /* Player cell index in the padded board */
+    unsigned short boxes;       /* Number of boxes */
+    const uint64_t* walls;
+    const uint64_t* goals;
+    const uint64_t* floor;      /* Cells the player can reach, ignoring boxes */
+    const uint64_t* box_bits;
+    const unsigned char* solution;  /* Push-optimal moves, 2 bits each (LURD), or NULL */
+    unsigned short solution_moves;
+} EmbeddedLevel;
+
+/* Direction of move i of a packed solution, four moves per byte from the LSB */
+#define SOLUTION_MOVE(solution, i) (((solution)[(i) >> 2] >> (((i) & 3) * 2)) & 3)
+
 #endif /* LEVELS_H */
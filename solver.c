@@ -0,0 +1,562 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "solver.h"
+#include "deadlock.h"
+#include "engine.h"
+
+/* Nodes live in fixed-size chunks so their addresses never move */
+#define CHUNK_BITS 16
+#define CHUNK_SIZE (1 << CHUNK_BITS)
+#define MAX_CHUNKS 4096
+
+/* Transposition table shards, each with its own lock */
+#define SHARD_BITS 6
+#define NUM_SHARDS (1 << SHARD_BITS)
+
+/* Frontier nodes handed to a worker at a time */
+#define BATCH_SIZE 64
+
+/* A stored search state; its box bitboard lives in a parallel chunk */
+typedef struct {
+    uint64_t hash;
+    int32_t parent;
+    uint16_t player;        /* Normalized (pushes) or exact (moves) player cell */
+    uint16_t move;          /* Pushes: box cell << 2 | dir, moves: push flag << 2 | dir */
+} Node;
+
+/* Open addressing table of node index + 1 for one hash shard */
+typedef struct {
+    pthread_mutex_t lock;
+    uint32_t* table;
+    long mask;
+    long used;
+} Shard;
+
+typedef struct {
+    const Board* board;     /* Points at local, which carries dead squares */
+    Board local;
+    unsigned char cells[BOARD_MAX_CELLS];
+    SolveMetric metric;
+    int words;
+    int threads;
+    long max_nodes;
+    uint64_t goals[BOARD_MAX_WORDS];
+
+    /* Node store */
+    _Atomic(Node*) node_chunks[MAX_CHUNKS];
+    _Atomic(uint64_t*) box_chunks[MAX_CHUNKS];
+    pthread_mutex_t chunk_lock;
+    atomic_long count;
+
+    /* Transposition table */
+    Shard shards[NUM_SHARDS];
+
+    /* Current frontier [next, layer_end) and outcome */
+    atomic_long next;
+    long layer_end;
+    atomic_long found;
+    atomic_int failed;
+} Solver;
+
+/* Per-thread counters */
+typedef struct {
+    Solver* solver;
+    long expanded;
+    long generated;
+    long pruned;
+} Worker;
+
+static Node* node_at(Solver* s, long index) {
+    return &atomic_load_explicit(&s->node_chunks[index >> CHUNK_BITS],
+                                 memory_order_acquire)[index & (CHUNK_SIZE - 1)];
+}
+
+static uint64_t* boxes_at(Solver* s, long index) {
+    return atomic_load_explicit(&s->box_chunks[index >> CHUNK_BITS], memory_order_acquire) +
+           (index & (CHUNK_SIZE - 1)) * s->words;
+}
+
+/* Make sure the chunk holding index exists */
+static int ensure_chunk(Solver* s, long index) {
+    long c = index >> CHUNK_BITS;
+    Node* nodes;
+    uint64_t* boxes;
+    int status = 0;
+
+    if (atomic_load_explicit(&s->box_chunks[c], memory_order_acquire)) {
+        return 0;
+    }
+    pthread_mutex_lock(&s->chunk_lock);
+    if (!atomic_load_explicit(&s->box_chunks[c], memory_order_relaxed)) {
+        nodes = (Node*)malloc(CHUNK_SIZE * sizeof(Node));
+        boxes = (uint64_t*)malloc((size_t)CHUNK_SIZE * s->words * sizeof(uint64_t));
+        if (nodes && boxes) {
+            atomic_store_explicit(&s->node_chunks[c], nodes, memory_order_release);
+            atomic_store_explicit(&s->box_chunks[c], boxes, memory_order_release);
+        } else {
+            free(nodes);
+            free(boxes);
+            status = -1;
+        }
+    }
+    pthread_mutex_unlock(&s->chunk_lock);
+    return status;
+}
+
+static int is_solved(const Solver* s, const uint64_t* boxes) {
+    int i;
+
+    for (i = 0; i < s->words; i++) {
+        if (boxes[i] & ~s->goals[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Double a shard's table and reinsert its nodes */
+static int grow_shard(Solver* s, Shard* shard) {
+    long size = (shard->mask + 1) * 2;
+    uint32_t* table = (uint32_t*)calloc(size, sizeof(uint32_t));
+    long i, slot;
+
+    if (!table) {
+        return -1;
+    }
+    for (i = 0; i <= shard->mask; i++) {
+        if (!shard->table[i]) {
+            continue;
+        }
+        slot = node_at(s, shard->table[i] - 1)->hash & (size - 1);
+        while (table[slot]) {
+            slot = (slot + 1) & (size - 1);
+        }
+        table[slot] = shard->table[i];
+    }
+    free(shard->table);
+    shard->table = table;
+    shard->mask = size - 1;
+    return 0;
+}
+
+/* Store a state unless already known, returns its index, -1 if seen, -2 on failure */
+static long insert(Worker* w, const uint64_t* boxes, int player, uint64_t hash,
+                   long parent, int move) {
+    Solver* s = w->solver;
+    Shard* shard = &s->shards[hash >> (64 - SHARD_BITS)];
+    long slot, index = -1;
+    Node* node;
+
+    w->generated++;
+    if (s->threads > 1) {
+        pthread_mutex_lock(&shard->lock);
+    }
+
+    for (slot = hash & shard->mask; shard->table[slot]; slot = (slot + 1) & shard->mask) {
+        index = shard->table[slot] - 1;
+        node = node_at(s, index);
+        if (node->hash == hash && node->player == player &&
+            memcmp(boxes_at(s, index), boxes, s->words * sizeof(uint64_t)) == 0) {
+            index = -1;
+            goto done;
+        }
+    }
+
+    index = atomic_fetch_add(&s->count, 1);
+    if ((s->max_nodes && index >= s->max_nodes) || index >= (long)MAX_CHUNKS * CHUNK_SIZE ||
+        ensure_chunk(s, index) != 0) {
+        index = -2;
+        goto done;
+    }
+
+    node = node_at(s, index);
+    node->hash = hash;
+    node->parent = (int32_t)parent;
+    node->player = (uint16_t)player;
+    node->move = (uint16_t)move;
+    memcpy(boxes_at(s, index), boxes, s->words * sizeof(uint64_t));
+    shard->table[slot] = (uint32_t)(index + 1);
+
+    if (++shard->used * 2 > shard->mask + 1 && grow_shard(s, shard) != 0) {
+        index = -2;
+    }
+
+done:
+    if (s->threads > 1) {
+        pthread_mutex_unlock(&shard->lock);
+    }
+    return index;
+}
+
+/* Generate every push from a node, returns a solved index, -1 or -2 */
+static long expand_pushes(Worker* w, long index) {
+    Solver* s = w->solver;
+    const Board* b = s->board;
+    uint64_t boxes[BOARD_MAX_WORDS];
+    uint64_t reach[BOARD_MAX_WORDS];
+    uint64_t hash = node_at(s, index)->hash;
+    int player = node_at(s, index)->player;
+    int i, d, box, dest, norm;
+    uint64_t word;
+    long child;
+
+    memcpy(boxes, boxes_at(s, index), s->words * sizeof(uint64_t));
+    board_reach(b, boxes, player, reach);
+
+    /* Walk the boxes rather than the reachable cells: a push needs the
+     * player's side of the box in reach and the far side free */
+    for (i = 0; i < s->words; i++) {
+        for (word = boxes_at(s, index)[i]; word; word &= word - 1) {
+            box = i * 64 + __builtin_ctzll(word);
+            for (d = 0; d < 4; d++) {
+                if (!bb_test(reach, box - b->delta[d])) {
+                    continue;
+                }
+                dest = box + b->delta[d];
+                if (!(b->cells[dest] & CELL_FLOOR) || bb_test(boxes, dest)) {
+                    continue;
+                }
+
+                bb_clear(boxes, box);
+                bb_set(boxes, dest);
+                if (deadlock_after_push(b, boxes, dest)) {
+                    w->pruned++;
+                    bb_clear(boxes, dest);
+                    bb_set(boxes, box);
+                    continue;
+                }
+                norm = board_normalize(b, boxes, box);
+                child = insert(w, boxes, norm,
+                               hash ^ zobrist_box[box] ^ zobrist_box[dest] ^
+                               zobrist_player[player] ^ zobrist_player[norm],
+                               index, box << 2 | d);
+                if (child >= 0 && is_solved(s, boxes)) {
+                    return child;
+                }
+                bb_clear(boxes, dest);
+                bb_set(boxes, box);
+
+                if (child == -2) {
+                    return -2;
+                }
+            }
+        }
+    }
+    return -1;
+}
+
+/* Generate every single step from a node, returns a solved index, -1 or -2 */
+static long expand_moves(Worker* w, long index) {
+    Solver* s = w->solver;
+    const Board* b = s->board;
+    uint64_t boxes[BOARD_MAX_WORDS];
+    uint64_t hash = node_at(s, index)->hash;
+    int player = node_at(s, index)->player;
+    int d, next, dest, push;
+    long child;
+
+    memcpy(boxes, boxes_at(s, index), s->words * sizeof(uint64_t));
+    for (d = 0; d < 4; d++) {
+        next = player + b->delta[d];
+        if (!(b->cells[next] & CELL_FLOOR)) {
+            continue;
+        }
+        push = bb_test(boxes, next);
+        dest = next + b->delta[d];
+        if (push && (!(b->cells[dest] & CELL_FLOOR) || bb_test(boxes, dest))) {
+            continue;
+        }
+
+        if (push) {
+            bb_clear(boxes, next);
+            bb_set(boxes, dest);
+            if (deadlock_after_push(b, boxes, dest)) {
+                w->pruned++;
+                bb_clear(boxes, dest);
+                bb_set(boxes, next);
+                continue;
+            }
+            child = insert(w, boxes, next,
+                           hash ^ zobrist_box[next] ^ zobrist_box[dest] ^
+                           zobrist_player[player] ^ zobrist_player[next],
+                           index, 4 | d);
+            if (child >= 0 && is_solved(s, boxes)) {
+                return child;
+            }
+            bb_clear(boxes, dest);
+            bb_set(boxes, next);
+        } else {
+            child = insert(w, boxes, next,
+                           hash ^ zobrist_player[player] ^ zobrist_player[next],
+                           index, d);
+        }
+
+        if (child == -2) {
+            return -2;
+        }
+    }
+    return -1;
+}
+
+/* Expand frontier batches until the layer is exhausted or the search ends */
+static void* search_layer(void* arg) {
+    Worker* w = (Worker*)arg;
+    Solver* s = w->solver;
+    long first, index, last, found;
+
+    while (atomic_load(&s->found) < 0 && !atomic_load(&s->failed)) {
+        first = atomic_fetch_add(&s->next, BATCH_SIZE);
+        if (first >= s->layer_end) {
+            break;
+        }
+        last = first + BATCH_SIZE < s->layer_end ? first + BATCH_SIZE : s->layer_end;
+        for (index = first; index < last; index++) {
+            found = (s->metric == SOLVE_PUSHES) ? expand_pushes(w, index)
+                                                : expand_moves(w, index);
+            w->expanded++;
+            if (found == -2) {
+                atomic_store(&s->failed, 1);
+                break;
+            }
+            if (found >= 0) {
+                atomic_store(&s->found, found);
+                break;
+            }
+        }
+    }
+    return NULL;
+}
+
+/* Growable solution string */
+typedef struct {
+    char* data;
+    int len;
+    int cap;
+} Path;
+
+static int path_add(Path* p, char ch) {
+    char* data;
+
+    if (p->len + 2 > p->cap) {
+        p->cap = p->cap ? p->cap * 2 : 256;
+        data = (char*)realloc(p->data, p->cap);
+        if (!data) {
+            return -1;
+        }
+        p->data = data;
+    }
+    p->data[p->len++] = ch;
+    p->data[p->len] = '\0';
+    return 0;
+}
+
+/* Append the shortest walk from *player to target, avoiding boxes */
+static int append_walk(const Board* b, const uint64_t* boxes, int* player, int target,
+                       Path* path) {
+    unsigned char steps[BOARD_MAX_CELLS];
+    int n, i;
+
+    n = board_path(b, boxes, *player, target, steps);
+    if (n < 0) {
+        return -1;
+    }
+    for (i = 0; i < n; i++) {
+        if (path_add(path, board_lurd[steps[i]]) != 0) {
+            return -1;
+        }
+    }
+    *player = target;
+    return 0;
+}
+
+/* Turn the parent chain ending at index into a LURD string */
+static int build_solution(Solver* s, long index, SolveResult* result) {
+    const Board* b = s->board;
+    uint64_t boxes[BOARD_MAX_WORDS];
+    uint16_t* moves;
+    Path path = { NULL, 0, 0 };
+    int count = 0, player = b->player;
+    int i, d, box;
+    long n;
+
+    for (n = index; n > 0; n = node_at(s, n)->parent) {
+        count++;
+    }
+    moves = (uint16_t*)malloc((count + 1) * sizeof(uint16_t));
+    if (!moves) {
+        return -1;
+    }
+    i = count;
+    for (n = index; n > 0; n = node_at(s, n)->parent) {
+        moves[--i] = node_at(s, n)->move;
+    }
+
+    memcpy(boxes, b->boxes, b->words * sizeof(uint64_t));
+    path_add(&path, '\0');
+    path.len = 0;
+    result->pushes = 0;
+    for (i = 0; i < count; i++) {
+        d = moves[i] & 3;
+        if (s->metric == SOLVE_MOVES) {
+            if (moves[i] & 4) {
+                box = player + b->delta[d];
+                bb_clear(boxes, box);
+                bb_set(boxes, box + b->delta[d]);
+                path_add(&path, board_lurd[d] - 'a' + 'A');
+                result->pushes++;
+            } else {
+                path_add(&path, board_lurd[d]);
+            }
+            player += b->delta[d];
+            continue;
+        }
+
+        box = moves[i] >> 2;
+        if (append_walk(b, boxes, &player, box - b->delta[d], &path) != 0) {
+            free(moves);
+            free(path.data);
+            return -1;
+        }
+        bb_clear(boxes, box);
+        bb_set(boxes, box + b->delta[d]);
+        player = box;
+        path_add(&path, board_lurd[d] - 'a' + 'A');
+        result->pushes++;
+    }
+
+    free(moves);
+    result->lurd = path.data;
+    result->moves = path.len;
+    return 0;
+}
+
+/* Level-synchronous breadth-first search for an optimal solution,
+ * split across worker threads; returns 0 when solved */
+int solve_board(const Board* board, const SolveOptions* options, SolveResult* result) {
+    Solver* s;
+    Worker* workers;
+    pthread_t* tids;
+    uint64_t boxes[BOARD_MAX_WORDS];
+    uint64_t hash = 0;
+    long layer_start = 0, found = -1;
+    int pos, player, i, threads;
+    double start = engine_seconds();
+
+    memset(result, 0, sizeof(*result));
+    zobrist_init();
+
+    threads = options->threads > 0 ? options->threads : 1;
+    s = (Solver*)calloc(1, sizeof(Solver));
+    workers = (Worker*)calloc(threads, sizeof(Worker));
+    tids = (pthread_t*)calloc(threads, sizeof(pthread_t));
+    if (!s || !workers || !tids) {
+        free(s);
+        free(workers);
+        free(tids);
+        return -1;
+    }
+    s->local = *board;
+    s->local.cells = s->cells;
+    memcpy(s->cells, board->cells, board->size);
+    deadlock_mark_dead(&s->local);
+    s->board = &s->local;
+    s->metric = options->metric;
+    s->words = board->words;
+    s->threads = threads;
+    s->max_nodes = options->max_nodes;
+    atomic_init(&s->count, 0);
+    atomic_init(&s->found, -1);
+    atomic_init(&s->failed, 0);
+    pthread_mutex_init(&s->chunk_lock, NULL);
+    for (i = 0; i < NUM_SHARDS; i++) {
+        pthread_mutex_init(&s->shards[i].lock, NULL);
+        s->shards[i].mask = 255;
+        s->shards[i].table = (uint32_t*)calloc(s->shards[i].mask + 1, sizeof(uint32_t));
+        if (!s->shards[i].table) {
+            atomic_store(&s->failed, 1);
+        }
+    }
+    for (i = 0; i < threads; i++) {
+        workers[i].solver = s;
+    }
+
+    memset(boxes, 0, sizeof(boxes));
+    for (pos = 0; pos < board->size; pos++) {
+        if (board->cells[pos] & CELL_GOAL) {
+            bb_set(s->goals, pos);
+        }
+        if (bb_test(board->boxes, pos)) {
+            bb_set(boxes, pos);
+            hash ^= zobrist_box[pos];
+        }
+    }
+
+    player = board->player;
+    if (s->metric == SOLVE_PUSHES) {
+        player = board_normalize(s->board, boxes, player);
+    }
+    hash ^= zobrist_player[player];
+
+    if (!atomic_load(&s->failed) && insert(&workers[0], boxes, player, hash, -1, 0) == 0) {
+        if (is_solved(s, boxes)) {
+            atomic_store(&s->found, 0);
+        }
+        /* Children of layer k get indices past its end, so each layer is a
+         * contiguous index range and the first goal found is optimal */
+        while (atomic_load(&s->found) < 0 && !atomic_load(&s->failed) &&
+               layer_start < atomic_load(&s->count)) {
+            s->layer_end = atomic_load(&s->count);
+            atomic_store(&s->next, layer_start);
+            if (threads == 1) {
+                search_layer(&workers[0]);
+            } else {
+                for (i = 0; i < threads; i++) {
+                    pthread_create(&tids[i], NULL, search_layer, &workers[i]);
+                }
+                for (i = 0; i < threads; i++) {
+                    pthread_join(tids[i], NULL);
+                }
+            }
+            layer_start = s->layer_end;
+        }
+    }
+
+    found = atomic_load(&s->found);
+    if (found >= 0 && build_solution(s, found, result) == 0) {
+        result->solved = 1;
+    }
+    result->stored = atomic_load(&s->count);
+    if (s->max_nodes && result->stored > s->max_nodes) {
+        result->stored = s->max_nodes;
+    }
+    for (i = 0; i < threads; i++) {
+        result->expanded += workers[i].expanded;
+        result->generated += workers[i].generated;
+        result->pruned += workers[i].pruned;
+    }
+    result->seconds = engine_seconds() - start;
+
+    for (i = 0; i < MAX_CHUNKS && s->box_chunks[i]; i++) {
+        free(s->node_chunks[i]);
+        free(s->box_chunks[i]);
+    }
+    for (i = 0; i < NUM_SHARDS; i++) {
+        free(s->shards[i].table);
+        pthread_mutex_destroy(&s->shards[i].lock);
+    }
+    pthread_mutex_destroy(&s->chunk_lock);
+    free(tids);
+    free(workers);
+    free(s);
+
+    return result->solved ? 0 : -1;
+}
+
+/* Release the solution string */
+void solve_result_free(SolveResult* result) {
+    free(result->lurd);
+    result->lurd = NULL;
+}
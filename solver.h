@@ -0,0 +1,33 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include "board.h"
+
+/* What the solver minimizes */
+typedef enum {
+    SOLVE_PUSHES,   /* Fewest pushes, state = boxes + normalized player */
+    SOLVE_MOVES     /* Fewest moves, state = boxes + exact player */
+} SolveMetric;
+
+typedef struct {
+    SolveMetric metric;
+    long max_nodes;         /* Stored state limit, 0 = unlimited */
+    int threads;            /* Worker threads, 0 or 1 = single-threaded */
+} SolveOptions;
+
+typedef struct {
+    int solved;
+    char* lurd;             /* Solution in LURD notation (malloc'd) */
+    int moves;
+    int pushes;
+    long expanded;          /* States expanded */
+    long generated;         /* Successor states generated */
+    long pruned;            /* Pushes cut off as deadlocks */
+    long stored;            /* Unique states stored */
+    double seconds;
+} SolveResult;
+
+int solve_board(const Board* board, const SolveOptions* options, SolveResult* result);
+void solve_result_free(SolveResult* result);
+
+#endif /* SOLVER_H */
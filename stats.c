@@ -0,0 +1,234 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "stats.h"
+
+/* Keys read but not yet on screen */
+#define MAX_PENDING 4096
+
+typedef struct {
+    long calls;
+    uint64_t total;
+    uint64_t max;
+} Timer;
+
+int stats_enabled = 0;
+
+static const char* timer_names[STAT_TIMERS] = {
+    "move_player", "draw_cell", "draw_map", "refresh"
+};
+
+static Timer timers[STAT_TIMERS];
+
+/* Output relay: the measured fd writes into a pipe, and a thread copies what
+ * arrives to the fd's original target, counting it */
+static int relay_fd = -1;       /* Measured fd, now the pipe's write end */
+static int relay_out = -1;      /* Where relay_fd pointed before */
+static int relay_in = -1;       /* Pipe's read end */
+static int relay_stderr = -1;   /* stderr while it is lent to the terminal */
+static pthread_t relay_thread;
+static uint64_t bytes_written;
+static long write_calls;
+static long keys;
+static long frames;
+static uint64_t pending[MAX_PENDING];
+static int pending_count;
+static long latency[STAT_BUCKETS];
+static uint64_t latency_total;
+static uint64_t latency_max;
+
+/* Monotonic clock in nanoseconds */
+uint64_t stats_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Copy the pipe to the real output until every write end is closed. Bytes
+ * the output refuses are dropped, so the writer never blocks on a full pipe */
+static void* relay(void* arg) {
+    char buffer[4096];
+    ssize_t n, done, sent;
+
+    (void)arg;
+    while ((n = read(relay_in, buffer, sizeof(buffer))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        bytes_written += n;
+        write_calls++;
+        for (done = 0; done < n; done += sent) {
+            sent = write(relay_out, buffer + done, n - done);
+            if (sent < 0 && errno == EINTR) {
+                sent = 0;
+            } else if (sent <= 0) {
+                break;
+            }
+        }
+    }
+    return NULL;
+}
+
+/* Point the measured fd back at its target and wait for the relay to drain */
+static void relay_stop(void) {
+    if (relay_fd < 0) {
+        return;
+    }
+    fflush(NULL);
+    dup2(relay_out, relay_fd);
+    close(relay_out);
+    pthread_join(relay_thread, NULL);
+    close(relay_in);
+    if (relay_stderr >= 0) {
+        dup2(relay_stderr, STDERR_FILENO);
+        close(relay_stderr);
+        relay_stderr = -1;
+    }
+    relay_fd = -1;
+}
+
+/* Start measuring, counting the bytes written to fd; returns -1 if the
+ * relay cannot be set up */
+int stats_start(int fd) {
+    static int registered = 0;
+    int pipe_fds[2];
+
+    relay_stop();
+    memset(timers, 0, sizeof(timers));
+    memset(latency, 0, sizeof(latency));
+    bytes_written = 0;
+    write_calls = 0;
+    keys = 0;
+    frames = 0;
+    pending_count = 0;
+    latency_total = 0;
+    latency_max = 0;
+    fflush(NULL);
+    if (pipe(pipe_fds) != 0) {
+        return -1;
+    }
+    relay_out = dup(fd);
+    if (relay_out < 0 || dup2(pipe_fds[1], fd) < 0) {
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        if (relay_out >= 0) {
+            close(relay_out);
+        }
+        return -1;
+    }
+    close(pipe_fds[1]);
+    relay_in = pipe_fds[0];
+    if (pthread_create(&relay_thread, NULL, relay, NULL) != 0) {
+        dup2(relay_out, fd);
+        close(relay_out);
+        close(relay_in);
+        return -1;
+    }
+    relay_fd = fd;
+    if (!registered) {
+        atexit(relay_stop);
+        registered = 1;
+    }
+
+    /* Curses takes the terminal's modes and size from stderr when stdout is
+     * not a terminal, so lend it the terminal if it was redirected */
+    if (fd == STDOUT_FILENO && isatty(relay_out) && !isatty(STDERR_FILENO)) {
+        relay_stderr = dup(STDERR_FILENO);
+        dup2(relay_out, STDERR_FILENO);
+    }
+    stats_enabled = 1;
+    return 0;
+}
+
+/* Add the time since start to a section */
+void stats_time(int timer, uint64_t start) {
+    uint64_t elapsed = stats_now() - start;
+
+    timers[timer].calls++;
+    timers[timer].total += elapsed;
+    if (elapsed > timers[timer].max) {
+        timers[timer].max = elapsed;
+    }
+}
+
+/* Note a key as read; its latency runs until the next stats_frame() */
+void stats_key(void) {
+    keys++;
+    if (pending_count < MAX_PENDING) {
+        pending[pending_count++] = stats_now();
+    }
+}
+
+/* A frame reached the terminal: close the latency of every pending key */
+void stats_frame(void) {
+    uint64_t now = stats_now();
+    uint64_t us;
+    int i, b;
+
+    frames++;
+    for (i = 0; i < pending_count; i++) {
+        us = (now - pending[i]) / 1000;
+        for (b = 0; b < STAT_BUCKETS - 1 && us >= (1ULL << b); b++) {
+        }
+        latency[b]++;
+        latency_total += us;
+        if (us > latency_max) {
+            latency_max = us;
+        }
+    }
+    pending_count = 0;
+}
+
+/* Print the summary; output is no longer counted after this */
+void stats_report(FILE* out) {
+    long timed = 0, peak = 0;
+    int i, b, width;
+
+    relay_stop();
+    for (b = 0; b < STAT_BUCKETS; b++) {
+        timed += latency[b];
+        if (latency[b] > peak) {
+            peak = latency[b];
+        }
+    }
+
+    fprintf(out, "Terminal output: %llu bytes in %ld writes, %ld frames (%.1f bytes/frame)\n",
+            (unsigned long long)bytes_written, write_calls, frames,
+            frames ? (double)bytes_written / frames : 0.0);
+    fprintf(out, "Keys: %ld (%.2f per frame)\n", keys, frames ? (double)keys / frames : 0.0);
+
+    if (timed > 0) {
+        fprintf(out, "\nKey latency, input to refresh done: avg %.0f us, max %llu us\n",
+                (double)latency_total / timed, (unsigned long long)latency_max);
+        for (b = 0; b < STAT_BUCKETS; b++) {
+            if (latency[b] == 0) {
+                continue;
+            }
+            if (b == STAT_BUCKETS - 1) {
+                fprintf(out, "  >= %8llu us %8ld ", 1ULL << (b - 1), latency[b]);
+            } else {
+                fprintf(out, "  <  %8llu us %8ld ", 1ULL << b, latency[b]);
+            }
+            for (width = (int)(40 * latency[b] / peak); width > 0; width--) {
+                fputc('#', out);
+            }
+            fputc('\n', out);
+        }
+    }
+
+    fprintf(out, "\n%-12s %10s %12s %10s %10s\n", "Section", "Calls", "Total ms", "Avg us", "Max us");
+    for (i = 0; i < STAT_TIMERS; i++) {
+        fprintf(out, "%-12s %10ld %12.3f %10.2f %10.2f\n", timer_names[i], timers[i].calls,
+                timers[i].total / 1e6,
+                timers[i].calls ? timers[i].total / 1e3 / timers[i].calls : 0.0,
+                timers[i].max / 1e3);
+    }
+}
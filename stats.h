@@ -0,0 +1,26 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* Timed sections, each inclusive of anything it calls */
+#define STAT_MOVE       0   /* move_player() */
+#define STAT_DRAW_CELL  1   /* draw_cell() */
+#define STAT_DRAW_MAP   2   /* draw_map() */
+#define STAT_REFRESH    3   /* The refresh() ending each input burst */
+#define STAT_TIMERS     4
+
+/* Latency histogram buckets, powers of two from 1 us */
+#define STAT_BUCKETS    24
+
+extern int stats_enabled;
+
+uint64_t stats_now(void);
+int stats_start(int fd);
+void stats_time(int timer, uint64_t start);
+void stats_key(void);
+void stats_frame(void);
+void stats_report(FILE* out);
+
+#endif /* STATS_H */
@@ -2,10 +2,20 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <unistd.h>
 
 /* Include the embedded levels and game definitions */
 #include "embedded_levels.h"
 #include "levels.h"
+#include "board.h"
+#include "solver.h"
+#include "deadlock.h"
+#include "history.h"
+#include "stats.h"
+#include "engine.h"
+#include "import.h"
+#include "hint.h"
+#include "verify.h"
 
 /* Color pairs */
 #define PAIR_WALL      1  /* WHITE on BLUE */
@@ -24,33 +34,103 @@
 #define DISP_BOX_ON_GOAL '0'
 #define DISP_GOAL 'O'
 
+/* Milliseconds between checks for a hint while one is being searched */
+#define HINT_POLL_MS 20
+
+/* Playback speed when --fps is not given, and its limits for + and - */
+#define DEFAULT_FPS 10.0
+#define MAX_FPS     1000.0
+
+/* Neighbor walls, as the index into the wall glyph tables */
+#define WALL_UP     1
+#define WALL_DOWN   2
+#define WALL_LEFT   4
+#define WALL_RIGHT  8
+
+/* Screen characters built once per level, colors and attributes included */
+typedef struct {
+    chtype* cells;          /* Static layer per board cell: wall glyph, goal or floor */
+    int capacity;
+    chtype player;
+    chtype box;
+    chtype box_on_goal;
+} Render;
+
+/* Where the map window is on the screen and which part of the map it shows */
+typedef struct {
+    int start_y;            /* Screen position of the map window */
+    int start_x;
+    int view_y;             /* Top left map cell shown in the window */
+    int view_x;
+    int view_h;             /* Map rows and columns that fit on the screen */
+    int view_w;
+    int status_shown;       /* Status line contents on screen (see draw_status), -1 if unknown */
+} Screen;
+
 /* Game state */
 typedef struct {
-    char** map;
-    int width;
-    int height;
-    int player_x;
-    int player_y;
-    int boxes_total;
-    int boxes_on_goal;
-    char* level_name;
+    Board board;            /* Walls, goals, dead squares, boxes and player */
+    LevelSet levels;        /* Embedded levels or the -f pack, and which one is played */
+    Screen screen;          /* Map window layout */
     int use_ascii_borders;
     int use_colors;
+    int low_bandwidth;      /* --lowbw: plain characters, no title or legend */
+    int deadlocked;         /* Set once a push makes the level unsolvable */
+    int deadlock_move;      /* History position where that happened, -1 if none */
+    History history;        /* Undo/redo log */
+    uint64_t box_hash;      /* Zobrist hash of the box positions */
+    uint64_t hash;          /* box_hash ^ key of the player's normalized region */
+    uint64_t* seen;         /* Hash set of positions reached on this level */
+    int seen_mask;
+    int seen_count;
+    int repeated;           /* The last push led back to a position seen before */
+    int batch;              /* Set while walking a path: one refresh at the end */
+    int selected;           /* Box clicked and waiting for its destination, -1 if none */
+    Render render;          /* Precomputed screen characters */
+    double fps;             /* Playback frames per second, 0 for one frame per move, unpaced */
+    HintEngine hints;       /* Background search behind the ? key */
+    int hint_serial;        /* Hint request still awaited, 0 if none */
+    int hint_box;           /* Box the last hint highlights, -1 if none */
 } Game;
 
 /* Global variables */
-int current_level = 0;  /* Current level index */
-int num_levels = 0;     /* Total number of levels */
-int start_y = 0;        /* Start Y position for the map */
-int start_x = 0;        /* Start X position for the map */
+WINDOW* input_win;      /* Never drawn on, so reading keys from it skips getch()'s refresh */
 
 /* Function prototypes */
 void init_curses(void);
-char** load_level(int level_index, int* width, int* height, int* player_x, int* player_y, int* boxes);
-void free_map(char** map, int height);
-void draw_map(const Game* game);
+int load_level(Game* game, int level_index, int step);
+void goto_level(Game* game, int level_index, int step);
+void draw_map(Game* game);
+void layout_view(Game* game);
+int follow_player(Game* game);
+int follow_cell(Game* game, int pos);
+void draw_view(const Game* game);
+void draw_cell(const Game* game, int pos);
+void build_render(Game* game);
+chtype cell_glyph(const Game* game, int pos);
+void draw_status(Game* game);
 int move_player(Game* game, int dx, int dy);
+int undo_move(Game* game);
+int redo_move(Game* game);
+void seek_history(Game* game, int target);
+int remember_position(Game* game);
+int handle_key(Game* game, int ch);
+int go_to(Game* game, int pos);
+int push_box(Game* game, int box, int target);
+int cell_at(const Game* game, int y, int x);
+int pick_cell(Game* game, int pos, const char* prompt);
+void select_cell(Game* game);
+void click_cell(Game* game, int pos);
+void show_hint(Game* game);
+void show_solution(Game* game);
+int play_moves(Game* game, const unsigned char* dirs, int count);
+unsigned char* read_moves(const char* path, int* count);
+void request_hint(Game* game);
+void poll_hint(Game* game);
+void clear_hint(Game* game);
 void show_help(const char* program_name);
+int run_solver(const LevelSet* levels, const char* name, const SolveOptions* options,
+               int speedup);
 
 /* Function to display help */
 void show_help(const char* program_name) {
@@ -60,8 +140,33 @@ void show_help(const char* program_name) {
     printf("  -h, --help     Show this help message and exit\n");
     printf("  -a, --ascii    Use ASCII characters for walls instead of box drawing characters\n");
     printf("  -b, -bw        Black and white mode (disable colors)\n");
+    printf("  -f FILE        Play an XSB (plain or RLE) or SLC level pack instead of the built-in levels\n");
+    printf("  --lowbw        Low-bandwidth mode for slow links: plain ASCII, no title or legend\n");
+    printf("  --solve LEVEL  Solve an embedded level (e.g. L07.sok) or level file and exit\n");
+    printf("  --moves        Solve for fewest moves instead of fewest pushes\n");
+    printf("  --max-nodes N  Give up after storing N states\n");
+    printf("  --verify DIR   Check every NAME.sol (LURD moves) in DIR against NAME.sok in DIR\n");
+    printf("                 or the embedded level NAME, without curses, and exit\n");
+    printf("  -j N           Solver threads, verifier threads (0 = all cores)\n");
+    printf("  --speedup      Also time a 1-thread solve and report the speedup\n");
+    printf("  --stats[=FILE] Measure key latency, drawing time and terminal bytes; print\n");
+    printf("                 the summary on exit (to stderr, or to FILE)\n");
+    printf("  --replay LEVEL FILE\n");
+    printf("                 Play the LURD moves in FILE on an embedded level or level file,\n");
+    printf("                 then keep playing from there\n");
+    printf("  --fps N|max    Playback speed (default %.0f); with --replay, max draws every\n", DEFAULT_FPS);
+    printf("                 move as fast as possible to /dev/null and reports moves/s and bytes\n");
     printf("\nControls:\n");
     printf("  Arrow keys, WASD, or HJKL    Move player\n");
+    printf("  U                            Undo last move (shift-U to redo)\n");
+    printf("  [ ]                          Jump 100 moves back/forward in history\n");
+    printf("  < >                          Jump to start/end of history\n");
+    printf("  G or mouse click             Walk to a cell (G picks it with the cursor keys)\n");
+    printf("                               Pick a box first to push it to the next cell picked\n");
+    printf("  I                            Hint: the next move of the stored solution\n");
+    printf("  ?                            Suggest a push from the current position\n");
+    printf("  V                            View the stored solution from the start\n");
+    printf("                               (+ and - change the speed, any other key stops)\n");
     printf("  R                            Restart current level\n");
     printf("  N                            Next level\n");
     printf("  P                            Previous level\n");
@@ -74,17 +179,39 @@ int main(int argc, char *argv[]) {
     /* Game state */
     Game game;
     int game_running = 1;
-    int level_complete = 0;
     int ch;
     int i;
+    const char* solve_level = NULL;
+    SolveOptions solve_options = { SOLVE_PUSHES, 0, 0 };
+    const char* verify_path = NULL;
+    int solve_speedup = 0;
+    const char* stats_file = NULL;
+    const char* pack_file = NULL;
+    FILE* stats_out;
+    uint64_t start;
+    const char* replay_level = NULL;
+    const char* replay_file = NULL;
+    unsigned char* replay_dirs = NULL;
+    int replay_count = 0;
+    int played, first, skipped;
+    FILE* null_term = NULL;
+    const char* term;
 
     /* Initialize level variables */
-    current_level = 0;
-    num_levels = NUM_EMBEDDED_LEVELS;
+    levels_init(&game.levels, embedded_levels, NUM_EMBEDDED_LEVELS);
+    game.fps = DEFAULT_FPS;
+    game.screen.start_y = 0;
+    game.screen.start_x = 0;
+    game.screen.view_y = 0;
+    game.screen.view_x = 0;
+    game.screen.view_h = 0;
+    game.screen.view_w = 0;
+    game.screen.status_shown = -1;
 
     /* Check for command line flags */
     game.use_ascii_borders = 0;
     game.use_colors = 1;  /* Colors enabled by default */
+    game.low_bandwidth = 0;
 
     for (i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
@@ -97,14 +224,127 @@ int main(int argc, char *argv[]) {
         if (strcmp(argv[i], "-b") == 0 || strcmp(argv[i], "-bw") == 0) {
             game.use_colors = 0;  /* Disable colors */
         }
+        if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            pack_file = argv[++i];
+        }
+        if (strcmp(argv[i], "--lowbw") == 0) {
+            /* No attributes and no alternate character set to switch in and out of */
+            game.low_bandwidth = 1;
+            game.use_colors = 0;
+            game.use_ascii_borders = 1;
+        }
+        if (strcmp(argv[i], "--solve") == 0 && i + 1 < argc) {
+            solve_level = argv[++i];
+        }
+        if (strcmp(argv[i], "--verify") == 0 && i + 1 < argc) {
+            verify_path = argv[++i];
+        }
+        if (strcmp(argv[i], "--moves") == 0) {
+            solve_options.metric = SOLVE_MOVES;
+        }
+        if (strcmp(argv[i], "--max-nodes") == 0 && i + 1 < argc) {
+            solve_options.max_nodes = atol(argv[++i]);
+        }
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            solve_options.threads = atoi(argv[++i]);
+        }
+        if (strcmp(argv[i], "--speedup") == 0) {
+            solve_speedup = 1;
+        }
+        if (strcmp(argv[i], "--replay") == 0 && i + 2 < argc) {
+            replay_level = argv[++i];
+            replay_file = argv[++i];
+        }
+        if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            i++;
+            game.fps = strcmp(argv[i], "max") == 0 ? 0 : atof(argv[i]);
+            if (game.fps < 0 || (game.fps == 0 && strcmp(argv[i], "max") != 0)) {
+                fprintf(stderr, "Bad frame rate: %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+            if (game.fps > MAX_FPS) {
+                game.fps = MAX_FPS;
+            }
+        }
+        if (strcmp(argv[i], "--stats") == 0) {
+            stats_file = "";
+        } else if (strncmp(argv[i], "--stats=", 8) == 0) {
+            stats_file = argv[i] + 8;
+        }
+    }
+
+    /* The solver and the checker run on all cores unless -j says otherwise */
+    if (solve_options.threads <= 0) {
+        solve_options.threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+
+    /* Headless solution checker */
+    if (verify_path) {
+        i = verify_dir(verify_path, solve_options.threads, &game.levels);
+        return i == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    /* Headless solver mode */
+    if (solve_level) {
+        return run_solver(&game.levels, solve_level, &solve_options, solve_speedup) == 0 ?
+               EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    /* Index the level pack; levels are parsed as they are played */
+    if (pack_file) {
+        if (levels_open_pack(&game.levels, pack_file) != 0) {
+            fprintf(stderr, "Cannot read levels from %s\n", pack_file);
+            return EXIT_FAILURE;
+        }
     }
 
-    /* Initialize ncurses - completely skip color initialization in black and white mode */
-    initscr();
+    /* Replay: an embedded level by name, else the first level of a file */
+    if (replay_level) {
+        levels_close(&game.levels);
+        replay_dirs = read_moves(replay_file, &replay_count);
+        if (!replay_dirs) {
+            return EXIT_FAILURE;
+        }
+        game.levels.current = levels_find(&game.levels, replay_level);
+        if (game.levels.current < 0 && levels_open_pack(&game.levels, replay_level) != 0) {
+            fprintf(stderr, "Level not found or invalid: %s\n", replay_level);
+            free(replay_dirs);
+            return EXIT_FAILURE;
+        }
+    }
+
+    /* Count from before initscr() so the terminal setup is included */
+    if (stats_file && stats_start(STDOUT_FILENO) != 0) {
+        fprintf(stderr, "Cannot relay the terminal output to measure it\n");
+        return EXIT_FAILURE;
+    }
+
+    /* Initialize ncurses - completely skip color initialization in black and white mode.
+     * A replay at --fps max draws to /dev/null instead, counting what it sends */
+    if (replay_level && game.fps == 0) {
+        null_term = fopen("/dev/null", "r+");
+        term = getenv("TERM");
+        if (!null_term || stats_start(fileno(null_term)) != 0 ||
+            !newterm(term && *term ? term : "xterm", null_term, null_term)) {
+            fprintf(stderr, "Cannot set up a terminal on /dev/null\n");
+            return EXIT_FAILURE;
+        }
+    } else {
+        initscr();
+    }
     cbreak();
     noecho();
     keypad(stdscr, TRUE);
     curs_set(0);
+
+    /* Clicks walk the player; report presses at once rather than waiting to resolve clicks */
+    mousemask(BUTTON1_PRESSED | BUTTON1_CLICKED, NULL);
+    mouseinterval(0);
+    input_win = newwin(1, 1, 0, 0);
+    keypad(input_win, TRUE);
+
+    /* Let curses scroll the terminal when the map window moves */
+    idlok(stdscr, TRUE);
     
     /* Only initialize colors if we're using color mode */
     if (game.use_colors && has_colors()) {
@@ -119,274 +359,381 @@ int main(int argc, char *argv[]) {
         init_pair(PAIR_TITLE, COLOR_RED, COLOR_BLACK);
     }
 
-    if (num_levels == 0) {
+    if (game.levels.count == 0) {
         endwin();
         fprintf(stderr, "No embedded levels found.\n");
         return EXIT_FAILURE;
     }
 
     /* Load first level */
-    game.map = load_level(current_level, &game.width, &game.height,
-                          &game.player_x, &game.player_y, &game.boxes_total);
-    game.boxes_on_goal = 0;
-    game.level_name = strdup(embedded_levels[current_level].name);
+    memset(&game.board, 0, sizeof(game.board));
+    memset(&game.history, 0, sizeof(game.history));
+    game.seen = NULL;
+    game.seen_mask = 0;
+    game.batch = 0;
+    game.render.cells = NULL;
+    game.render.capacity = 0;
+    game.hint_serial = 0;
+    game.hint_box = -1;
+    hint_init(&game.hints);
+    /* A replay needs its own level; otherwise start at the first that loads */
+    first = game.levels.current;
+    skipped = load_level(&game, first, 1);
+    if (skipped < 0 || (replay_level && skipped > 0)) {
+        endwin();
+        fprintf(stderr, "Level %d cannot be loaded\n", first + 1);
+        return EXIT_FAILURE;
+    }
 
     /* Do initial full screen draw */
-    clear();
     draw_map(&game);
+
+    if (replay_level) {
+        start = stats_now();
+        played = play_moves(&game, replay_dirs, replay_count);
+        free(replay_dirs);
+        if (null_term) {
+            start = stats_now() - start;
+            delwin(input_win);
+            endwin();
+            printf("Replayed %d of %d moves on %s in %.3f s: %.0f moves/s, level %s\n",
+                   played, replay_count, game.levels.name, start / 1e9,
+                   start ? played * 1e9 / start : 0.0,
+                   game.board.boxes_on_goal == game.board.boxes_total ? "solved" :
+                   played < replay_count ? "not solved, next move blocked" : "not solved");
+            stats_report(stdout);
+            hint_free(&game.hints);
+            board_free(&game.board);
+            history_free(&game.history);
+            free(game.seen);
+            free(game.render.cells);
+            levels_close(&game.levels);
+            fclose(null_term);
+            return EXIT_SUCCESS;
+        }
+    }
     
-    /* Game loop */
+    /* Game loop: wait for a key, then apply every key already typed ahead
+     * (held arrows, pasted move strings) before showing a single frame */
     while (game_running) {
-        /* Check if level is complete */
-        if (game.boxes_on_goal == game.boxes_total) {
-            level_complete = 1;
-            if (game.use_colors) {
-                attron(A_STANDOUT);
-            }
-            mvprintw(start_y + game.height + 3, start_x, "Level complete! Press 'n' for next level.");
-            if (game.use_colors) {
-                attroff(A_STANDOUT);
+        /* While a hint is searched, wake up now and then to show it */
+        wtimeout(input_win, game.hint_serial ? HINT_POLL_MS : -1);
+        ch = wgetch(input_win);
+        if (ch == ERR) {
+            poll_hint(&game);
+            continue;
+        }
+        game.batch = 1;
+        nodelay(input_win, TRUE);
+        while (ch != ERR && game_running) {
+            if (stats_enabled) {
+                stats_key();
             }
+            game_running = handle_key(&game, ch);
+            ch = wgetch(input_win);
         }
-
-        /* Get input */
-        ch = getch();
-
-        /* Process input */
-        switch (ch) {
-            case KEY_UP:
-            case 'w':
-            case 'W':
-            case 'k':
-            case 'K':
-                move_player(&game, 0, -1);
-                break;
-            case KEY_DOWN:
-            case 's':
-            case 'S':
-            case 'j':
-            case 'J':
-                move_player(&game, 0, 1);
-                break;
-            case KEY_LEFT:
-            case 'a':
-            case 'A':
-            case 'h':
-            case 'H':
-                move_player(&game, -1, 0);
-                break;
-            case KEY_RIGHT:
-            case 'd':
-            case 'D':
-                move_player(&game, 1, 0);
-                break;
-            /* Handle 'l' and 'L' separately since 'L' is now used for redraw */
-            case 'l':
-                move_player(&game, 1, 0);
-                break;
-            case 'c':
-                /* Force a full redraw */
-                clear();
-                draw_map(&game);
-                break;
-            case 'r':
-                /* Restart level */
-                free_map(game.map, game.height);
-                game.map = load_level(current_level, &game.width, &game.height,
-                                      &game.player_x, &game.player_y, &game.boxes_total);
-                game.boxes_on_goal = 0;
-                /* Do a full redraw after restart */
-                clear();
-                draw_map(&game);
-                break;
-            case 'n':
-                /* Next level */
-                if (current_level < num_levels - 1 || level_complete) {
-                    free_map(game.map, game.height);
-                    free(game.level_name);
-
-                    if (level_complete) {
-                        current_level = (current_level + 1) % num_levels;
-                        level_complete = 0;
-                    } else {
-                        current_level++;
-                    }
-
-                    game.map = load_level(current_level, &game.width, &game.height,
-                                         &game.player_x, &game.player_y, &game.boxes_total);
-                    game.boxes_on_goal = 0;
-                    game.level_name = strdup(embedded_levels[current_level].name);
-                    
-                    /* Full redraw for new level */
-                    clear();
-                    draw_map(&game);
-                }
-                break;
-            case 'p':
-                /* Previous level */
-                if (current_level > 0) {
-                    free_map(game.map, game.height);
-                    free(game.level_name);
-                    current_level--;
-                    game.map = load_level(current_level, &game.width, &game.height,
-                                         &game.player_x, &game.player_y, &game.boxes_total);
-                    game.boxes_on_goal = 0;
-                    game.level_name = strdup(embedded_levels[current_level].name);
-                    level_complete = 0;
-                    
-                    /* Full redraw for new level */
-                    clear();
-                    draw_map(&game);
-                }
-                break;
-            case 'q':
-                /* Quit */
-                game_running = 0;
-                break;
+        nodelay(input_win, FALSE);
+        game.batch = 0;
+        start = stats_enabled ? stats_now() : 0;
+        refresh();
+        if (stats_enabled) {
+            stats_time(STAT_REFRESH, start);
+            stats_frame();
         }
     }
 
     /* Clean up */
-    free_map(game.map, game.height);
-    free(game.level_name);
+    hint_free(&game.hints);
+    board_free(&game.board);
+    history_free(&game.history);
+    free(game.seen);
+    free(game.render.cells);
+    levels_close(&game.levels);
+    delwin(input_win);
     endwin();
 
+    if (stats_file) {
+        stats_out = *stats_file ? fopen(stats_file, "w") : stderr;
+        if (!stats_out) {
+            perror(stats_file);
+            return EXIT_FAILURE;
+        }
+        stats_report(stats_out);
+        if (stats_out != stderr) {
+            fclose(stats_out);
+        }
+    }
+
     return EXIT_SUCCESS;
 }
 
-/* Initialize ncurses */
-/* Function replaced with inline code in main */
-void init_curses(void) {
-    /* This function is no longer used */
-}
+/* Apply one key press, returns 0 when the player quits */
+int handle_key(Game* game, int ch) {
+    /* Check if level is complete (the status line already says so) */
+    int level_complete = (game->board.boxes_on_goal == game->board.boxes_total);
+    MEVENT event;
 
-/* Load a level from embedded data */
-char** load_level(int level_index, int* width, int* height, int* player_x, int* player_y, int* boxes) {
-    const char* level_data;
-    const char* ptr;
-    int max_width = 0;
-    int num_lines = 0;
-    char** map;
-    int line_idx;
-    int i, j, len;
-    const char* line_start;
-    
-    if (level_index < 0 || level_index >= NUM_EMBEDDED_LEVELS) {
-        endwin();
-        fprintf(stderr, "Invalid level index: %d\n", level_index);
-        exit(EXIT_FAILURE);
+    /* Any key drops a box picked by a click */
+    if (ch != KEY_MOUSE) {
+        game->selected = -1;
+    }
+    /* and a hint, which is for the position it was asked in */
+    if (ch != '?') {
+        clear_hint(game);
     }
 
-    level_data = embedded_levels[level_index].data;
-    ptr = level_data;
-
-    /* Count the number of lines and find the longest line */
-    line_start = ptr;
-    while (*ptr) {
-        if (*ptr == '\n') {
-            len = ptr - line_start;
-            if (len > max_width) {
-                max_width = len;
+    switch (ch) {
+        case KEY_UP:
+        case 'w':
+        case 'W':
+        case 'k':
+        case 'K':
+            move_player(game, 0, -1);
+            break;
+        case KEY_DOWN:
+        case 's':
+        case 'S':
+        case 'j':
+        case 'J':
+            move_player(game, 0, 1);
+            break;
+        case KEY_LEFT:
+        case 'a':
+        case 'A':
+        case 'h':
+        case 'H':
+            move_player(game, -1, 0);
+            break;
+        case KEY_RIGHT:
+        case 'd':
+        case 'D':
+            move_player(game, 1, 0);
+            break;
+        /* Handle 'l' and 'L' separately since 'L' is now used for redraw */
+        case 'l':
+            move_player(game, 1, 0);
+            break;
+        case 'g':
+            select_cell(game);
+            break;
+        case KEY_MOUSE:
+            if (getmouse(&event) == OK && (event.bstate & (BUTTON1_PRESSED | BUTTON1_CLICKED))) {
+                click_cell(game, cell_at(game, event.y, event.x));
             }
-            num_lines++;
-            line_start = ptr + 1;
-        }
-        ptr++;
+            break;
+        case KEY_RESIZE:
+            /* Lay the frame out for the new size; only the difference is sent */
+            draw_map(game);
+            break;
+        case 'c':
+            /* Force a full repaint, the only time the terminal is cleared */
+            clearok(curscr, TRUE);
+            draw_map(game);
+            break;
+        case 'u':
+            undo_move(game);
+            break;
+        case 'U':
+            redo_move(game);
+            break;
+        case '[':
+            seek_history(game, game->history.cursor - 100);
+            break;
+        case ']':
+            seek_history(game, game->history.cursor + 100);
+            break;
+        case '<':
+            seek_history(game, 0);
+            break;
+        case '>':
+            seek_history(game, game->history.length);
+            break;
+        case 'i':
+            show_hint(game);
+            break;
+        case 'v':
+            show_solution(game);
+            break;
+        case '?':
+            request_hint(game);
+            break;
+        case 'r':
+            /* Restart level from its snapshot; the moves stay available for redo */
+            seek_history(game, 0);
+            break;
+        case 'n':
+            /* Next level */
+            if (game->levels.current < game->levels.count - 1 || level_complete) {
+                goto_level(game, (game->levels.current + 1) % game->levels.count, 1);
+            }
+            break;
+        case 'p':
+            /* Previous level */
+            if (game->levels.current > 0) {
+                goto_level(game, game->levels.current - 1, -1);
+            }
+            break;
+        case 'q':
+            /* Quit */
+            return 0;
     }
+    return 1;
+}
 
-    /* Check for last line without newline */
-    if (ptr > line_start) {
-        len = ptr - line_start;
-        if (len > max_width) {
-            max_width = len;
-        }
-        num_lines++;
+/* Solve a level without curses and print the result */
+int run_solver(const LevelSet* levels, const char* name, const SolveOptions* options,
+               int speedup) {
+    Board board;
+    SolveResult result, baseline;
+    SolveOptions single = *options;
+
+    memset(&board, 0, sizeof(board));
+    if (levels_load_named(levels, name, &board) != 0) {
+        fprintf(stderr, "Level not found or invalid: %s\n", name);
+        board_free(&board);
+        return -1;
     }
 
-    /* Allocate memory for the map */
-    map = (char**)malloc(num_lines * sizeof(char*));
-    for (i = 0; i < num_lines; i++) {
-        map[i] = (char*)malloc((max_width + 1) * sizeof(char));
-        /* Initialize with spaces */
-        for (j = 0; j < max_width; j++) {
-            map[i][j] = EMPTY;
-        }
-        map[i][max_width] = '\0';
+    solve_board(&board, options, &result);
+    if (result.solved) {
+        printf("Solution: %s\n", result.lurd);
+        printf("Moves: %d, Pushes: %d (%s-optimal)\n", result.moves, result.pushes,
+               options->metric == SOLVE_MOVES ? "move" : "push");
+    } else {
+        printf("No solution found%s\n",
+               options->max_nodes && result.stored >= options->max_nodes ? " (node limit reached)" : "");
+    }
+    printf("Nodes: %ld generated, %ld expanded, %ld stored, %ld deadlocks pruned in %.3f s "
+           "(%.0f nodes/sec, %d thread%s)\n",
+           result.generated, result.expanded, result.stored, result.pruned, result.seconds,
+           result.seconds > 0 ? result.generated / result.seconds : 0.0,
+           options->threads, options->threads == 1 ? "" : "s");
+
+    if (speedup) {
+        single.threads = 1;
+        solve_board(&board, &single, &baseline);
+        printf("Baseline: %.3f s with 1 thread, speedup %.2fx on %d threads\n",
+               baseline.seconds, result.seconds > 0 ? baseline.seconds / result.seconds : 0.0,
+               options->threads);
+        solve_result_free(&baseline);
     }
 
-    /* Parse the map data */
-    *boxes = 0;
-    line_idx = 0;
-    ptr = level_data;
-
-    line_start = ptr;
-    while (*ptr) {
-        if (*ptr == '\n' || *(ptr + 1) == '\0') {
-            /* If it's the last character and not a newline, include it */
-            len = ptr - line_start;
-            if (*ptr != '\n' && *(ptr + 1) == '\0') {
-                len++;
-            }
-
-            /* Copy the line */
-            for (i = 0; i < len; i++) {
-                map[line_idx][i] = line_start[i];
+    solve_result_free(&result);
+    board_free(&board);
+    return result.solved ? 0 : -1;
+}
 
-                /* Count boxes and find player position */
-                if (line_start[i] == BOX || line_start[i] == BOX_ON_GOAL) {
-                    (*boxes)++;
-                }
-                if (line_start[i] == PLAYER) {
-                    *player_x = i;
-                    *player_y = line_idx;
-                }
-                if (line_start[i] == PLAYER_ON_GOAL) {
-                    *player_x = i;
-                    *player_y = line_idx;
-                }
-            }
+/* Initialize ncurses */
+/* Function replaced with inline code in main */
+void init_curses(void) {
+    /* This function is no longer used */
+}
 
-            line_idx++;
-            line_start = ptr + 1;
+/* Load a level from the pack or the embedded data into the game board, or
+ * if it does not load, the nearest one after it going by step. Returns how
+ * many levels were skipped, or -1 if none loads and the game stays as it was */
+int load_level(Game* game, int level_index, int step) {
+    int skipped = 0;
+
+    while (levels_load(&game->levels, level_index, &game->board) != 0) {
+        level_index += step;
+        skipped++;
+        if (level_index < 0 || level_index >= game->levels.count) {
+            return -1;
         }
-        ptr++;
     }
 
-    /* Set the width and height */
-    *width = max_width;
-    *height = num_lines;
+    deadlock_mark_dead(&game->board);
+    hint_level(&game->hints, &game->board);
+    game->hint_serial = 0;
+    game->hint_box = -1;
+    build_render(game);
+    history_reset(&game->history, &game->board);
+    game->deadlocked = 0;
+    game->deadlock_move = -1;
+    game->selected = -1;
+    game->screen.view_x = 0;
+    game->screen.view_y = 0;
+
+    /* Hash the start position and begin a fresh set of seen positions */
+    zobrist_init();
+    game->box_hash = board_box_hash(&game->board);
+    game->hash = game->box_hash ^
+                 zobrist_player[board_normalize(&game->board, game->board.boxes, game->board.player)];
+    if (game->seen) {
+        memset(game->seen, 0, (game->seen_mask + 1) * sizeof(uint64_t));
+    }
+    game->seen_count = 0;
+    game->repeated = 0;
+    remember_position(game);
+    return skipped;
+}
 
-    return map;
+/* Switch levels with n or p, telling the player about levels that did not load */
+void goto_level(Game* game, int level_index, int step) {
+    int skipped = load_level(game, level_index, step);
+
+    if (skipped >= 0) {
+        draw_map(game);
+    }
+    if (skipped == 0) {
+        return;
+    }
+    if (skipped < 0) {
+        mvprintw(game->screen.start_y + game->screen.view_h + 3, game->screen.start_x,
+                 "Level %d cannot be loaded", level_index + 1);
+    } else {
+        mvprintw(game->screen.start_y + game->screen.view_h + 3, game->screen.start_x,
+                 "Skipped %d level%s that cannot be loaded", skipped, skipped > 1 ? "s" : "");
+    }
+    clrtoeol();
+    game->screen.status_shown = -1;
 }
 
-/* Free the map memory */
-void free_map(char** map, int height) {
-    int i;
+/* Add the current position hash to the seen set, returns 1 if it was already there */
+int remember_position(Game* game) {
+    uint64_t* old = game->seen;
+    int old_mask = game->seen_mask;
+    int slot, i;
+
+    /* Keep the table at most half full */
+    if (!game->seen || (game->seen_count + 1) * 2 > game->seen_mask + 1) {
+        game->seen_mask = old ? old_mask * 2 + 1 : 1023;
+        game->seen = (uint64_t*)calloc(game->seen_mask + 1, sizeof(uint64_t));
+        if (!game->seen) {
+            game->seen = old;
+            game->seen_mask = old_mask;
+            return 0;
+        }
+        for (i = 0; old && i <= old_mask; i++) {
+            if (old[i]) {
+                for (slot = old[i] & game->seen_mask; game->seen[slot];
+                     slot = (slot + 1) & game->seen_mask) {
+                }
+                game->seen[slot] = old[i];
+            }
+        }
+        free(old);
+    }
 
-    for (i = 0; i < height; i++) {
-        free(map[i]);
+    for (slot = game->hash & game->seen_mask; game->seen[slot];
+         slot = (slot + 1) & game->seen_mask) {
+        if (game->seen[slot] == game->hash) {
+            return 1;
+        }
     }
-    free(map);
+    game->seen[slot] = game->hash;
+    game->seen_count++;
+    return 0;
 }
 
 /* Draw the map */
-void draw_map(const Game* game) {
-    int y, x;
-    char ch;
+void draw_map(Game* game) {
+    uint64_t start = stats_enabled ? stats_now() : 0;
     int screen_width, screen_height;
 
-    /* Get terminal dimensions */
     getmaxyx(stdscr, screen_height, screen_width);
-
-    /* Remove the top title since we've moved it to the status section */
-
-    /* Calculate centering offsets - add 2 to start_y for the title */
-    start_y = (screen_height - game->height) / 2 ;
-    start_x = (screen_width - game->width) / 2;
-
-    /* Make sure we don't go off screen */
-    start_y = (start_y < 2) ? 2 : start_y;
-    start_x = (start_x < 0) ? 0 : start_x;
+    layout_view(game);
 
     /* Set default colors ONLY if using color mode */
     if (game->use_colors && has_colors()) {
@@ -394,159 +741,12 @@ void draw_map(const Game* game) {
     }
     /* For black and white mode, don't set any attributes at all */
 
-    /* Clear the screen */
-    clear();
-
-    /* First clear the background for the entire map area */
-    for (y = 0; y < game->height; y++) {
-        for (x = 0; x < game->width; x++) {
-            mvaddch(start_y + y, start_x + x, ' ');
-        }
-    }
-
-    /* Then draw the map elements */
-    for (y = 0; y < game->height; y++) {
-        for (x = 0; x < game->width; x++) {
-            ch = game->map[y][x];
-
-            /* Apply colors if enabled */
-            if (game->use_colors && has_colors()) {
-                switch (ch) {
-                    case WALL:
-                        attron(COLOR_PAIR(PAIR_WALL));
-                        break;
-                    case PLAYER:
-                    case PLAYER_ON_GOAL:
-                        attron(COLOR_PAIR(PAIR_PLAYER));
-                        break;
-                    case BOX:
-                        attron(COLOR_PAIR(PAIR_BOX));
-                        break;
-                    case GOAL:
-                        attron(COLOR_PAIR(PAIR_GOAL));
-                        break;
-                    case BOX_ON_GOAL:
-                        attron(COLOR_PAIR(PAIR_BOX_GOAL));
-                        break;
-                    case EMPTY:
-                        attron(COLOR_PAIR(PAIR_FLOOR));
-                        break;
-                    default:
-                        attron(COLOR_PAIR(PAIR_DEFAULT));
-                        break;
-                }
-            }
-            
-            /* Draw map elements */
-            if (ch == WALL) {
-                /* Walls don't get bold attribute */
-                
-                /* Use box drawing characters instead of reverse video */
-                int up = (y > 0 && game->map[y-1][x] == WALL);
-                int down = (y < game->height-1 && game->map[y+1][x] == WALL);
-                int left = (x > 0 && game->map[y][x-1] == WALL);
-                int right = (x < game->width-1 && game->map[y][x+1] == WALL);
-
-                /* Apply reverse video for walls when colors are enabled */
-                if (game->use_colors) {
-                    attron(A_REVERSE);
-                }
-                
-                if (game->use_ascii_borders) {
-                    /* ASCII box characters */
-                    if (up && down && left && right) mvaddch(start_y + y, start_x + x, '+');
-                    else if (up && down && left) mvaddch(start_y + y, start_x + x, '+');
-                    else if (up && down && right) mvaddch(start_y + y, start_x + x, '+');
-                    else if (up && left && right) mvaddch(start_y + y, start_x + x, '+');
-                    else if (down && left && right) mvaddch(start_y + y, start_x + x, '+');
-                    else if (up && down) mvaddch(start_y + y, start_x + x, '|');
-                    else if (left && right) mvaddch(start_y + y, start_x + x, '-');
-                    else if (up && right) mvaddch(start_y + y, start_x + x, '+');
-                    else if (up && left) mvaddch(start_y + y, start_x + x, '+');
-                    else if (down && right) mvaddch(start_y + y, start_x + x, '+');
-                    else if (down && left) mvaddch(start_y + y, start_x + x, '+');
-                    else if (up) mvaddch(start_y + y, start_x + x, '|');
-                    else if (down) mvaddch(start_y + y, start_x + x, '|');
-                    else if (left) mvaddch(start_y + y, start_x + x, '-');
-                    else if (right) mvaddch(start_y + y, start_x + x, '-');
-                    else mvaddch(start_y + y, start_x + x, '+');
-                } else {
-                    /* Box drawing characters */
-                    if (up && down && left && right) mvaddch(start_y + y, start_x + x, ACS_PLUS);
-                    else if (up && down && left) mvaddch(start_y + y, start_x + x, ACS_RTEE);
-                    else if (up && down && right) mvaddch(start_y + y, start_x + x, ACS_LTEE);
-                    else if (up && left && right) mvaddch(start_y + y, start_x + x, ACS_BTEE);
-                    else if (down && left && right) mvaddch(start_y + y, start_x + x, ACS_TTEE);
-                    else if (up && down) mvaddch(start_y + y, start_x + x, ACS_VLINE);
-                    else if (left && right) mvaddch(start_y + y, start_x + x, ACS_HLINE);
-                    else if (up && right) mvaddch(start_y + y, start_x + x, ACS_LLCORNER);
-                    else if (up && left) mvaddch(start_y + y, start_x + x, ACS_LRCORNER);
-                    else if (down && right) mvaddch(start_y + y, start_x + x, ACS_ULCORNER);
-                    else if (down && left) mvaddch(start_y + y, start_x + x, ACS_URCORNER);
-                    else if (up) mvaddch(start_y + y, start_x + x, ACS_VLINE);
-                    else if (down) mvaddch(start_y + y, start_x + x, ACS_VLINE);
-                    else if (left) mvaddch(start_y + y, start_x + x, ACS_HLINE);
-                    else if (right) mvaddch(start_y + y, start_x + x, ACS_HLINE);
-                    else mvaddch(start_y + y, start_x + x, ACS_PLUS);
-                }
-                
-                /* Turn off reverse video */
-                if (game->use_colors) {
-                    attroff(A_REVERSE);
-                }
-            } else if (ch == PLAYER || ch == PLAYER_ON_GOAL) {
-                /* Apply bold attribute to game characters when colors are enabled */
-                if (game->use_colors) {
-                    attron(A_BOLD);
-                }
-                mvaddch(start_y + y, start_x + x, DISP_PLAYER);
-                if (game->use_colors) {
-                    attroff(A_BOLD);
-                }
-            } else if (ch == BOX) {
-                /* Apply bold attribute to game characters when colors are enabled */
-                if (game->use_colors) {
-                    attron(A_BOLD);
-                }
-                mvaddch(start_y + y, start_x + x, DISP_BOX);
-                if (game->use_colors) {
-                    attroff(A_BOLD);
-                }
-            } else if (ch == BOX_ON_GOAL) {
-                /* Apply bold attribute to game characters when colors are enabled */
-                if (game->use_colors) {
-                    attron(A_BOLD);
-                }
-                mvaddch(start_y + y, start_x + x, DISP_BOX_ON_GOAL);
-                if (game->use_colors) {
-                    attroff(A_BOLD);
-                }
-            } else if (ch == GOAL) {
-                /* Apply bold attribute to game characters when colors are enabled */
-                if (game->use_colors) {
-                    attron(A_BOLD);
-                }
-                mvaddch(start_y + y, start_x + x, DISP_GOAL);
-                if (game->use_colors) {
-                    attroff(A_BOLD);
-                }
-            } else {
-                mvaddch(start_y + y, start_x + x, ch);
-            }
+    /* Start the new frame from blank. erase() only wipes the buffer: curses
+     * keeps the last frame sent and refresh() writes just the cells that
+     * differ from it, where clear() would resend the whole screen */
+    erase();
 
-            
-            /* Reset colors for this cell */
-            if (game->use_colors && has_colors()) {
-                attroff(COLOR_PAIR(PAIR_WALL));
-                attroff(COLOR_PAIR(PAIR_PLAYER));
-                attroff(COLOR_PAIR(PAIR_BOX));
-                attroff(COLOR_PAIR(PAIR_GOAL));
-                attroff(COLOR_PAIR(PAIR_BOX_GOAL));
-                attroff(COLOR_PAIR(PAIR_FLOOR));
-                attron(COLOR_PAIR(PAIR_DEFAULT));
-            }
-        }
-    }
+    draw_view(game);
 
     /* Reset colors ONLY if using color mode */
     if (game->use_colors && has_colors()) {
@@ -558,270 +758,779 @@ void draw_map(const Game* game) {
     if (game->use_colors) {
         attron(A_BOLD);
     }
-    mvprintw(start_y + game->height + 1, start_x, "TTY SOKOBAN - github.com/tenox7/ttysokoban");
-    mvprintw(start_y + game->height + 2, start_x, "Level: %s (%d/%d)",
-             game->level_name, current_level + 1, num_levels);
-    mvprintw(start_y + game->height + 3, start_x, "Boxes: %d/%d", game->boxes_on_goal, game->boxes_total);
+    if (!game->low_bandwidth) {
+        mvaddnstr(game->screen.start_y + game->screen.view_h + 1, game->screen.start_x, "TTY SOKOBAN - github.com/tenox7/ttysokoban",
+                  screen_width - game->screen.start_x);
+    }
+    mvprintw(game->screen.start_y + game->screen.view_h + 2, game->screen.start_x, "Level: %s (%d/%d)",
+             game->levels.name, game->levels.current + 1, game->levels.count);
     if (game->use_colors) {
         attroff(A_BOLD);
     }
+    game->screen.status_shown = -1;
+    draw_status(game);
 
     /* Only display legend if there's enough screen space */
-    if (start_y + game->height + 6 < screen_height) {
-        mvprintw(start_y + game->height + 4, start_x, "Arrows/WASD/hjkl move");
-        mvprintw(start_y + game->height + 5, start_x, "[R]estart, [N]ext, [P]rev, [Q]uit, [C]lear");
+    if (!game->low_bandwidth && game->screen.start_y + game->screen.view_h + 6 < screen_height) {
+        mvaddnstr(game->screen.start_y + game->screen.view_h + 4, game->screen.start_x, "Arrows/WASD/hjkl move, [U]ndo, [G]o to, [I] hint",
+                  screen_width - game->screen.start_x);
+        mvaddnstr(game->screen.start_y + game->screen.view_h + 5, game->screen.start_x, "[R]estart, [N]ext, [P]rev, [Q]uit, [C]lear, [V]iew",
+                  screen_width - game->screen.start_x);
     }
 
-    refresh();
+    if (!game->batch) {
+        refresh();
+    }
+    if (stats_enabled) {
+        stats_time(STAT_DRAW_MAP, start);
+    }
 }
 
-/* Helper function to draw a cell */
-void draw_cell(const Game* game, int y, int x) {
-    char ch = game->map[y][x];
+/* Fit the map window to the terminal: centered when the level fits, else
+ * as much of it as leaves room for the status lines, following the player */
+void layout_view(Game* game) {
+    const Board* b = &game->board;
+    int screen_width, screen_height;
 
-    /* Apply colors if enabled */
-    if (game->use_colors && has_colors()) {
-        switch (ch) {
-            case WALL:
-                attron(COLOR_PAIR(PAIR_WALL));
-                break;
-            case PLAYER:
-            case PLAYER_ON_GOAL:
-                attron(COLOR_PAIR(PAIR_PLAYER));
-                break;
-            case BOX:
-                attron(COLOR_PAIR(PAIR_BOX));
-                break;
-            case GOAL:
-                attron(COLOR_PAIR(PAIR_GOAL));
-                break;
-            case BOX_ON_GOAL:
-                attron(COLOR_PAIR(PAIR_BOX_GOAL));
-                break;
-            case EMPTY:
-                attron(COLOR_PAIR(PAIR_FLOOR));
-                break;
-            default:
-                attron(COLOR_PAIR(PAIR_DEFAULT));
-                break;
-        }
+    /* Get terminal dimensions */
+    getmaxyx(stdscr, screen_height, screen_width);
+
+    game->screen.view_h = b->height < screen_height - 4 ? b->height : screen_height - 4;
+    game->screen.view_w = b->width < screen_width ? b->width : screen_width;
+    game->screen.view_h = game->screen.view_h < 1 ? 1 : game->screen.view_h;
+    game->screen.view_w = game->screen.view_w < 1 ? 1 : game->screen.view_w;
+
+    /* Calculate centering offsets, keeping 2 blank lines on top when there is room */
+    game->screen.start_y = (screen_height - game->screen.view_h) / 2;
+    game->screen.start_x = (screen_width - game->screen.view_w) / 2;
+    game->screen.start_y = (game->screen.start_y < 2) ? 2 : game->screen.start_y;
+    if (game->screen.start_y > screen_height - 4 - game->screen.view_h) {
+        game->screen.start_y = screen_height - 4 - game->screen.view_h;
     }
+    game->screen.start_y = (game->screen.start_y < 0) ? 0 : game->screen.start_y;
+    game->screen.start_x = (game->screen.start_x < 0) ? 0 : game->screen.start_x;
 
-    /* Draw map elements */
-    if (ch == WALL) {
-        /* Walls don't get bold attribute */
-        
-        /* Use box drawing characters instead of reverse video */
-        int up = (y > 0 && game->map[y-1][x] == WALL);
-        int down = (y < game->height-1 && game->map[y+1][x] == WALL);
-        int left = (x > 0 && game->map[y][x-1] == WALL);
-        int right = (x < game->width-1 && game->map[y][x+1] == WALL);
+    follow_player(game);
+}
 
-        /* Apply reverse video for walls when colors are enabled */
-        if (game->use_colors) {
-            attron(A_REVERSE);
-        }
-        
-        if (game->use_ascii_borders) {
-            /* ASCII box characters */
-            if (up && down && left && right) mvaddch(start_y + y, start_x + x, '+');
-            else if (up && down && left) mvaddch(start_y + y, start_x + x, '+');
-            else if (up && down && right) mvaddch(start_y + y, start_x + x, '+');
-            else if (up && left && right) mvaddch(start_y + y, start_x + x, '+');
-            else if (down && left && right) mvaddch(start_y + y, start_x + x, '+');
-            else if (up && down) mvaddch(start_y + y, start_x + x, '|');
-            else if (left && right) mvaddch(start_y + y, start_x + x, '-');
-            else if (up && right) mvaddch(start_y + y, start_x + x, '+');
-            else if (up && left) mvaddch(start_y + y, start_x + x, '+');
-            else if (down && right) mvaddch(start_y + y, start_x + x, '+');
-            else if (down && left) mvaddch(start_y + y, start_x + x, '+');
-            else if (up) mvaddch(start_y + y, start_x + x, '|');
-            else if (down) mvaddch(start_y + y, start_x + x, '|');
-            else if (left) mvaddch(start_y + y, start_x + x, '-');
-            else if (right) mvaddch(start_y + y, start_x + x, '-');
-            else mvaddch(start_y + y, start_x + x, '+');
-        } else {
-            /* Box drawing characters */
-            if (up && down && left && right) mvaddch(start_y + y, start_x + x, ACS_PLUS);
-            else if (up && down && left) mvaddch(start_y + y, start_x + x, ACS_RTEE);
-            else if (up && down && right) mvaddch(start_y + y, start_x + x, ACS_LTEE);
-            else if (up && left && right) mvaddch(start_y + y, start_x + x, ACS_BTEE);
-            else if (down && left && right) mvaddch(start_y + y, start_x + x, ACS_TTEE);
-            else if (up && down) mvaddch(start_y + y, start_x + x, ACS_VLINE);
-            else if (left && right) mvaddch(start_y + y, start_x + x, ACS_HLINE);
-            else if (up && right) mvaddch(start_y + y, start_x + x, ACS_LLCORNER);
-            else if (up && left) mvaddch(start_y + y, start_x + x, ACS_LRCORNER);
-            else if (down && right) mvaddch(start_y + y, start_x + x, ACS_ULCORNER);
-            else if (down && left) mvaddch(start_y + y, start_x + x, ACS_URCORNER);
-            else if (up) mvaddch(start_y + y, start_x + x, ACS_VLINE);
-            else if (down) mvaddch(start_y + y, start_x + x, ACS_VLINE);
-            else if (left) mvaddch(start_y + y, start_x + x, ACS_HLINE);
-            else if (right) mvaddch(start_y + y, start_x + x, ACS_HLINE);
-            else mvaddch(start_y + y, start_x + x, ACS_PLUS);
-        }
-        
-        /* Turn off reverse video */
-        if (game->use_colors) {
-            attroff(A_REVERSE);
-        }
-    } else if (ch == PLAYER || ch == PLAYER_ON_GOAL) {
-        /* Apply bold attribute to game characters when colors are enabled */
-        if (game->use_colors) {
-            attron(A_BOLD);
-        }
-        mvaddch(start_y + y, start_x + x, DISP_PLAYER);
-        if (game->use_colors) {
-            attroff(A_BOLD);
-        }
-    } else if (ch == BOX) {
-        /* Apply bold attribute to game characters when colors are enabled */
-        if (game->use_colors) {
-            attron(A_BOLD);
+/* Scroll the window so the player stays a quarter of it away from the
+ * edges (or the map ends), returns 1 if the view moved */
+int follow_player(Game* game) {
+    return follow_cell(game, game->board.player);
+}
+
+/* Scroll the window so a cell stays a quarter of it away from the edges
+ * (or the map ends), returns 1 if the view moved */
+int follow_cell(Game* game, int pos) {
+    const Board* b = &game->board;
+    int px = pos % b->stride - 1;
+    int py = pos / b->stride - 1;
+    int old_x = game->screen.view_x, old_y = game->screen.view_y;
+    int margin;
+
+    margin = game->screen.view_w / 4;
+    if (px < game->screen.view_x + margin) {
+        game->screen.view_x = px - margin;
+    } else if (px > game->screen.view_x + game->screen.view_w - 1 - margin) {
+        game->screen.view_x = px - game->screen.view_w + 1 + margin;
+    }
+    margin = game->screen.view_h / 4;
+    if (py < game->screen.view_y + margin) {
+        game->screen.view_y = py - margin;
+    } else if (py > game->screen.view_y + game->screen.view_h - 1 - margin) {
+        game->screen.view_y = py - game->screen.view_h + 1 + margin;
+    }
+
+    game->screen.view_x = game->screen.view_x > b->width - game->screen.view_w ? b->width - game->screen.view_w : game->screen.view_x;
+    game->screen.view_y = game->screen.view_y > b->height - game->screen.view_h ? b->height - game->screen.view_h : game->screen.view_y;
+    game->screen.view_x = game->screen.view_x < 0 ? 0 : game->screen.view_x;
+    game->screen.view_y = game->screen.view_y < 0 ? 0 : game->screen.view_y;
+    return game->screen.view_x != old_x || game->screen.view_y != old_y;
+}
+
+/* Draw the visible part of the map a row at a time from the render cache.
+ * After a scroll the rows come out shifted; with idlok() curses turns that
+ * into terminal scrolling instead of rewriting every cell */
+void draw_view(const Game* game) {
+    const Board* b = &game->board;
+    chtype row[BOARD_MAX_CELLS];
+    int y, x;
+
+    for (y = 0; y < game->screen.view_h; y++) {
+        for (x = 0; x < game->screen.view_w; x++) {
+            row[x] = cell_glyph(game, board_pos(b, game->screen.view_x + x, game->screen.view_y + y));
         }
-        mvaddch(start_y + y, start_x + x, DISP_BOX);
-        if (game->use_colors) {
-            attroff(A_BOLD);
+        mvaddchnstr(game->screen.start_y + y, game->screen.start_x, row, game->screen.view_w);
+    }
+}
+
+/* Fill the render cache for the loaded level: wall glyphs from a 4-bit
+ * neighbor mask, and every character with its color pair and attributes */
+void build_render(Game* game) {
+    static const char ascii_walls[16] = "+|||-+++-+++-+++";
+    const chtype acs_walls[16] = {
+        ACS_PLUS, ACS_VLINE, ACS_VLINE, ACS_VLINE,
+        ACS_HLINE, ACS_LRCORNER, ACS_URCORNER, ACS_RTEE,
+        ACS_HLINE, ACS_LLCORNER, ACS_ULCORNER, ACS_LTEE,
+        ACS_HLINE, ACS_BTEE, ACS_TTEE, ACS_PLUS
+    };
+    const Board* b = &game->board;
+    Render* r = &game->render;
+    int colors = game->use_colors && has_colors();
+    chtype bold = game->use_colors ? A_BOLD : 0;
+    chtype wall = (game->use_colors ? A_REVERSE : 0) | (colors ? COLOR_PAIR(PAIR_WALL) : 0);
+    chtype* grown;
+    int pos, mask;
+
+    if (b->size > r->capacity) {
+        grown = (chtype*)realloc(r->cells, b->size * sizeof(chtype));
+        if (!grown) {
+            endwin();
+            fprintf(stderr, "Out of memory\n");
+            exit(EXIT_FAILURE);
         }
-    } else if (ch == BOX_ON_GOAL) {
-        /* Apply bold attribute to game characters when colors are enabled */
-        if (game->use_colors) {
-            attron(A_BOLD);
+        r->cells = grown;
+        r->capacity = b->size;
+    }
+
+    r->player = DISP_PLAYER | bold | (colors ? COLOR_PAIR(PAIR_PLAYER) : 0);
+    r->box = DISP_BOX | bold | (colors ? COLOR_PAIR(PAIR_BOX) : 0);
+    r->box_on_goal = DISP_BOX_ON_GOAL | bold | (colors ? COLOR_PAIR(PAIR_BOX_GOAL) : 0);
+
+    for (pos = 0; pos < b->size; pos++) {
+        if (b->cells[pos] & CELL_EDGE) {
+            r->cells[pos] = ' ' | (colors ? COLOR_PAIR(PAIR_FLOOR) : 0);
+        } else if (b->cells[pos] & CELL_WALL) {
+            mask = (board_is_wall(b, pos - b->stride) ? WALL_UP : 0) |
+                   (board_is_wall(b, pos + b->stride) ? WALL_DOWN : 0) |
+                   (board_is_wall(b, pos - 1) ? WALL_LEFT : 0) |
+                   (board_is_wall(b, pos + 1) ? WALL_RIGHT : 0);
+            r->cells[pos] = (game->use_ascii_borders ? (chtype)ascii_walls[mask] : acs_walls[mask]) | wall;
+        } else if (b->cells[pos] & CELL_GOAL) {
+            r->cells[pos] = DISP_GOAL | bold | (colors ? COLOR_PAIR(PAIR_GOAL) : 0);
+        } else {
+            r->cells[pos] = ' ' | (colors ? COLOR_PAIR(PAIR_FLOOR) : 0);
         }
-        mvaddch(start_y + y, start_x + x, DISP_BOX_ON_GOAL);
-        if (game->use_colors) {
-            attroff(A_BOLD);
+    }
+}
+
+/* Screen character for a cell: the piece on it, else the cached static layer */
+chtype cell_glyph(const Game* game, int pos) {
+    const Board* b = &game->board;
+
+    if (bb_test(b->boxes, pos)) {
+        return ((b->cells[pos] & CELL_GOAL) ? game->render.box_on_goal : game->render.box) |
+               (pos == game->hint_box ? A_REVERSE : 0);
+    }
+    if (pos == b->player) {
+        return game->render.player;
+    }
+    return game->render.cells[pos];
+}
+
+/* Draw a single cell from the render cache */
+void draw_cell(const Game* game, int pos) {
+    uint64_t start = stats_enabled ? stats_now() : 0;
+    chtype glyph = cell_glyph(game, pos);
+    int y = pos / game->board.stride - 1 - game->screen.view_y;
+    int x = pos % game->board.stride - 1 - game->screen.view_x;
+
+    /* Cells outside the window are not sent at all */
+    if (y >= 0 && y < game->screen.view_h && x >= 0 && x < game->screen.view_w) {
+        mvaddchnstr(game->screen.start_y + y, game->screen.start_x + x, &glyph, 1);
+    }
+    if (stats_enabled) {
+        stats_time(STAT_DRAW_CELL, start);
+    }
+}
+
+/* Move the player */
+int move_player(Game* game, int dx, int dy) {
+    uint64_t start = stats_enabled ? stats_now() : 0;
+    Board* b = &game->board;
+    StepChange change;
+    int move = dx < 0 ? DIR_LEFT : dx > 0 ? DIR_RIGHT : dy < 0 ? DIR_UP : DIR_DOWN;
+    int i;
+
+    /* The rules live in engine_step(); what follows is bookkeeping and
+     * drawing the cells it reports changed */
+    if (engine_step(b, move, &change) < 0) {
+        return 0;
+    }
+    if (change.pushed) {
+        move |= MOVE_PUSH;
+    }
+
+    /* Log the move; a new move after undo discards the undone ones */
+    if (game->deadlock_move > game->history.cursor) {
+        game->deadlock_move = -1;
+    }
+    history_record(&game->history, b, move);
+
+    /* Check for a lost position */
+    if (change.pushed && !game->deadlocked && deadlock_after_push(b, b->boxes, change.cells[2])) {
+        game->deadlocked = 1;
+        game->deadlock_move = game->history.cursor;
+    }
+
+    /* Only pushes change the position: update its hash with two XORs for the
+     * box and a re-keyed player region, then look it up */
+    if (change.pushed) {
+        game->box_hash ^= zobrist_box[change.cells[1]] ^ zobrist_box[change.cells[2]];
+        game->hash = game->box_hash ^ zobrist_player[board_normalize(b, b->boxes, b->player)];
+        game->repeated = remember_position(game);
+    }
+
+    /* Optimized drawing - only redraw changed cells, or the window if it scrolled */
+    if (follow_player(game)) {
+        draw_view(game);
+    } else {
+        for (i = 0; i < change.count; i++) {
+            draw_cell(game, change.cells[i]);
         }
-    } else if (ch == GOAL) {
-        /* Apply bold attribute to game characters when colors are enabled */
+    }
+
+    draw_status(game);
+    if (!game->batch) {
+        refresh();
+    }
+    if (stats_enabled) {
+        stats_time(STAT_MOVE, start);
+    }
+    return 1;
+}
+
+/* Update the box count line, with the deadlock or level complete notice.
+ * Skipped when none of its fields changed since it was last drawn */
+void draw_status(Game* game) {
+    const Board* b = &game->board;
+    int status = b->boxes_on_goal | game->deadlocked << 16 | game->repeated << 17;
+
+    if (status == game->screen.status_shown) {
+        return;
+    }
+    game->screen.status_shown = status;
+
+    if (b->boxes_on_goal == b->boxes_total) {
         if (game->use_colors) {
-            attron(A_BOLD);
+            attron(A_STANDOUT);
         }
-        mvaddch(start_y + y, start_x + x, DISP_GOAL);
+        mvprintw(game->screen.start_y + game->screen.view_h + 3, game->screen.start_x, "Level complete! Press 'n' for next level.");
         if (game->use_colors) {
-            attroff(A_BOLD);
+            attroff(A_STANDOUT);
         }
+        clrtoeol();
+        return;
+    }
+
+    if (game->use_colors) {
+        attron(A_BOLD);
+    }
+    mvprintw(game->screen.start_y + game->screen.view_h + 3, game->screen.start_x, "Boxes: %d/%d", b->boxes_on_goal, b->boxes_total);
+    if (game->use_colors) {
+        attroff(A_BOLD);
+    }
+    if (game->deadlocked) {
+        printw("  Deadlock! [U]ndo or [R]estart");
+    } else if (game->repeated) {
+        printw("  You've been here before");
+    }
+    clrtoeol();
+}
+
+/* Follow a logged push from origin (either direction) in the position hash */
+static void update_hash(Game* game, int move, int origin) {
+    int delta = game->board.delta[MOVE_DIR(move)];
+
+    game->repeated = 0;
+    if (move & MOVE_PUSH) {
+        game->box_hash ^= zobrist_box[origin + delta] ^ zobrist_box[origin + 2 * delta];
+        game->hash = game->box_hash ^
+                     zobrist_player[board_normalize(&game->board, game->board.boxes, game->board.player)];
+    }
+}
+
+/* Redraw the cells a logged move starting at origin touched, then the status line */
+static void draw_move(Game* game, int move, int origin) {
+    int delta = game->board.delta[MOVE_DIR(move)];
+
+    game->deadlocked = game->deadlock_move >= 0 && game->history.cursor >= game->deadlock_move;
+    if (follow_player(game)) {
+        draw_view(game);
     } else {
-        mvaddch(start_y + y, start_x + x, ch);
+        draw_cell(game, origin);
+        draw_cell(game, origin + delta);
+        if (move & MOVE_PUSH) {
+            draw_cell(game, origin + 2 * delta);
+        }
     }
+    draw_status(game);
+    if (!game->batch) {
+        refresh();
+    }
+}
 
-    /* Reset colors for this cell */
-    if (game->use_colors && has_colors()) {
-        attroff(COLOR_PAIR(PAIR_WALL));
-        attroff(COLOR_PAIR(PAIR_PLAYER));
-        attroff(COLOR_PAIR(PAIR_BOX));
-        attroff(COLOR_PAIR(PAIR_GOAL));
-        attroff(COLOR_PAIR(PAIR_BOX_GOAL));
-        attroff(COLOR_PAIR(PAIR_FLOOR));
-        attron(COLOR_PAIR(PAIR_DEFAULT));
+/* Take back the last move in O(1), returns 1 if there was one */
+int undo_move(Game* game) {
+    int move = history_undo(&game->history, &game->board);
+
+    if (move < 0) {
+        return 0;
     }
+    update_hash(game, move, game->board.player);
+    draw_move(game, move, game->board.player);
+    return 1;
 }
 
-/* Move the player */
-int move_player(Game* game, int dx, int dy) {
-    int new_x = game->player_x + dx;
-    int new_y = game->player_y + dy;
-    int box_new_x, box_new_y;
-    char current_box;
-    char current_pos;
-    int old_player_x, old_player_y;
-    int moved_box = 0;
-
-    /* Check if new position is within bounds */
-    if (new_x < 0 || new_x >= game->width || new_y < 0 || new_y >= game->height) {
+/* Reapply an undone move, returns 1 if there was one */
+int redo_move(Game* game) {
+    int move = history_redo(&game->history, &game->board);
+
+    if (move < 0) {
         return 0;
     }
+    update_hash(game, move, game->board.player - game->board.delta[MOVE_DIR(move)]);
+    draw_move(game, move, game->board.player - game->board.delta[MOVE_DIR(move)]);
+    return 1;
+}
+
+/* Jump anywhere in the history through the nearest snapshot */
+void seek_history(Game* game, int target) {
+    history_seek(&game->history, &game->board, target);
+    game->box_hash = board_box_hash(&game->board);
+    game->hash = game->box_hash ^
+                 zobrist_player[board_normalize(&game->board, game->board.boxes, game->board.player)];
+    game->repeated = 0;
+    game->deadlocked = game->deadlock_move >= 0 && game->history.cursor >= game->deadlock_move;
+    draw_map(game);
+}
+
+/* Board cell under a screen position, or -1 outside the map */
+int cell_at(const Game* game, int y, int x) {
+    const Board* b = &game->board;
+
+    y -= game->screen.start_y;
+    x -= game->screen.start_x;
+    if (y < 0 || y >= game->screen.view_h || x < 0 || x >= game->screen.view_w) {
+        return -1;
+    }
+    return board_pos(b, game->screen.view_x + x, game->screen.view_y + y);
+}
+
+/* Take one step in a LURD direction */
+static int step_dir(Game* game, int d) {
+    static const int dir_dx[4] = { -1, 0, 1, 0 };
+    static const int dir_dy[4] = { 0, -1, 0, 1 };
+
+    return move_player(game, dir_dx[d], dir_dy[d]);
+}
+
+/* Apply the shortest walk to pos, returns the steps or -1 if out of reach */
+static int walk_to(Game* game, int pos) {
+    Board* b = &game->board;
+    uint64_t reach[BOARD_MAX_WORDS];
+    unsigned char dirs[BOARD_MAX_CELLS];
+    int n, i;
 
-    /* Check if new position is a wall */
-    if (game->map[new_y][new_x] == WALL) {
+    board_reach(b, b->boxes, b->player, reach);
+    if (!bb_test(reach, pos)) {
+        return -1;
+    }
+    n = board_path(b, b->boxes, b->player, pos, dirs);
+    for (i = 0; i < n; i++) {
+        step_dir(game, dirs[i]);
+    }
+    return n;
+}
+
+/* Walk the player to pos along a shortest path without pushing anything,
+ * drawing all the steps with a single refresh; returns the steps taken */
+int go_to(Game* game, int pos) {
+    int batch = game->batch;
+    int n;
+
+    if (pos < 0) {
         return 0;
     }
+    game->batch = 1;
+    n = walk_to(game, pos);
+    game->batch = batch;
+    if (!batch) {
+        refresh();
+    }
+    return n > 0 ? n : 0;
+}
 
-    /* Save positions for redraw */
-    old_player_x = game->player_x;
-    old_player_y = game->player_y;
+/* Push the box at box to target with the fewest pushes, walking in between,
+ * with a single refresh; returns the pushes made */
+int push_box(Game* game, int box, int target) {
+    Board* b = &game->board;
+    unsigned short pushes[BOARD_MAX_CELLS * 4];
+    int batch = game->batch;
+    int n, i, d;
 
-    /* Check if new position has a box */
-    if (game->map[new_y][new_x] == BOX || game->map[new_y][new_x] == BOX_ON_GOAL) {
-        box_new_x = new_x + dx;
-        box_new_y = new_y + dy;
+    if (box < 0 || target < 0) {
+        return 0;
+    }
+    n = board_push_path(b, box, target, pushes);
+    game->batch = 1;
+    for (i = 0; i < n; i++) {
+        d = pushes[i] & 3;
+        walk_to(game, (pushes[i] >> 2) - b->delta[d]);
+        step_dir(game, d);
+    }
+    game->batch = batch;
+    if (!batch) {
+        refresh();
+    }
+    return n > 0 ? n : 0;
+}
 
-        /* Check if box can be pushed */
-        if (box_new_x < 0 || box_new_x >= game->width || box_new_y < 0 || box_new_y >= game->height) {
-            return 0;
-        }
+/* Move a cursor over the map from pos with the movement keys; returns the
+ * cell picked with Enter, or -1 if cancelled */
+int pick_cell(Game* game, int pos, const char* prompt) {
+    const Board* b = &game->board;
+    int x = pos % b->stride - 1;
+    int y = pos / b->stride - 1;
+    int ch;
 
-        /* Check if the position the box would be pushed to is free */
-        if (game->map[box_new_y][box_new_x] != EMPTY && game->map[box_new_y][box_new_x] != GOAL) {
-            return 0;
+    mvprintw(game->screen.start_y + game->screen.view_h + 3, game->screen.start_x, "%s", prompt);
+    clrtoeol();
+    game->screen.status_shown = -1;
+    curs_set(1);
+    /* The cursor roams the whole map, scrolling the window along */
+    for (;;) {
+        if (follow_cell(game, board_pos(b, x, y))) {
+            draw_view(game);
         }
+        move(game->screen.start_y + y - game->screen.view_y, game->screen.start_x + x - game->screen.view_x);
+        refresh();
+        ch = getch();
+        switch (ch) {
+            case KEY_UP: case 'w': case 'k':
+                y -= y > 0;
+                break;
+            case KEY_DOWN: case 's': case 'j':
+                y += y < b->height - 1;
+                break;
+            case KEY_LEFT: case 'a': case 'h':
+                x -= x > 0;
+                break;
+            case KEY_RIGHT: case 'd': case 'l':
+                x += x < b->width - 1;
+                break;
+            case '\n': case '\r': case KEY_ENTER: case ' ': case 'g':
+                curs_set(0);
+                draw_status(game);
+                return board_pos(b, x, y);
+            case 27: case 'q':
+                curs_set(0);
+                if (follow_player(game)) {
+                    draw_view(game);
+                }
+                draw_status(game);
+                if (!game->batch) {
+                    refresh();
+                }
+                return -1;
+        }
+    }
+}
 
-        /* Push the box */
-        current_box = game->map[new_y][new_x];
-        moved_box = 1;
+/* Pick a cell and walk there, or pick a box and then where to push it */
+void select_cell(Game* game) {
+    int pos = pick_cell(game, game->board.player, "Go to: Enter walks, Esc cancels");
 
-        /* If the box is on a goal, reveal the goal when the box is moved */
-        if (current_box == BOX_ON_GOAL) {
-            game->map[new_y][new_x] = GOAL;
-            game->boxes_on_goal--;
-        } else {
-            game->map[new_y][new_x] = EMPTY;
+    if (pos >= 0 && bb_test(game->board.boxes, pos)) {
+        push_box(game, pos, pick_cell(game, pos, "Push to: Enter pushes, Esc cancels"));
+    } else {
+        go_to(game, pos);
+    }
+
+    /* The cursor may have scrolled the window away; bring the player back
+     * whether or not the walk or push happened */
+    if (follow_player(game)) {
+        draw_view(game);
+        if (!game->batch) {
+            refresh();
         }
+    }
+}
 
-        /* If the box is pushed onto a goal, mark it as such */
-        if (game->map[box_new_y][box_new_x] == GOAL) {
-            game->map[box_new_y][box_new_x] = BOX_ON_GOAL;
-            game->boxes_on_goal++;
-        } else {
-            game->map[box_new_y][box_new_x] = BOX;
+/* A click walks to the cell; a click on a box selects it and the next
+ * click pushes it there */
+void click_cell(Game* game, int pos) {
+    const Board* b = &game->board;
+
+    if (game->selected >= 0) {
+        pos = pos == game->selected ? -1 : pos;
+        push_box(game, game->selected, pos);
+        game->selected = -1;
+        draw_status(game);
+        if (!game->batch) {
+            refresh();
+        }
+    } else if (pos >= 0 && bb_test(b->boxes, pos)) {
+        game->selected = pos;
+        mvprintw(game->screen.start_y + game->screen.view_h + 3, game->screen.start_x, "Box selected: click where to push it");
+        clrtoeol();
+        game->screen.status_shown = -1;
+        if (!game->batch) {
+            refresh();
         }
+    } else {
+        go_to(game, pos);
     }
+}
 
-    /* Move the player */
-    current_pos = (game->map[game->player_y][game->player_x] == PLAYER_ON_GOAL) ? GOAL : EMPTY;
-    game->map[game->player_y][game->player_x] = current_pos;
+/* Show the next move of the stored solution on the status line, or how many
+ * moves to undo to get back on it */
+void show_hint(Game* game) {
+    static const char* dir_names[4] = { "Left", "Up", "Right", "Down" };
+    int cursor = game->history.cursor;
+    int i;
 
-    if (game->map[new_y][new_x] == GOAL) {
-        game->map[new_y][new_x] = PLAYER_ON_GOAL;
+    for (i = 0; i < cursor && i < game->levels.solution_moves; i++) {
+        if (MOVE_DIR(game->history.moves[i]) != SOLUTION_MOVE(game->levels.solution, i)) {
+            break;
+        }
+    }
+    if (!game->levels.solution) {
+        mvprintw(game->screen.start_y + game->screen.view_h + 3, game->screen.start_x, "No stored solution for this level");
+    } else if (i < cursor) {
+        mvprintw(game->screen.start_y + game->screen.view_h + 3, game->screen.start_x,
+                 "Off the stored solution: undo %d move%s",
+                 cursor - i, cursor - i == 1 ? "" : "s");
+    } else if (i == game->levels.solution_moves) {
+        mvprintw(game->screen.start_y + game->screen.view_h + 3, game->screen.start_x, "Level complete! Press 'n' for next level.");
     } else {
-        game->map[new_y][new_x] = PLAYER;
+        mvprintw(game->screen.start_y + game->screen.view_h + 3, game->screen.start_x, "Hint: %s (move %d of %d)",
+                 dir_names[SOLUTION_MOVE(game->levels.solution, i)], i + 1, game->levels.solution_moves);
+    }
+    clrtoeol();
+    game->screen.status_shown = -1;
+    if (!game->batch) {
+        refresh();
     }
+}
 
-    game->player_x = new_x;
-    game->player_y = new_y;
+/* Restart the level and play the stored solution back */
+void show_solution(Game* game) {
+    unsigned char* dirs;
+    int i;
 
-    /* Optimized drawing - only redraw changed cells */
-    /* Draw old player position */
-    draw_cell(game, old_player_y, old_player_x);
-    
-    /* Draw new player position */
-    draw_cell(game, game->player_y, game->player_x);
-    
-    /* If a box was moved, draw its new position */
-    if (moved_box) {
-        draw_cell(game, box_new_y, box_new_x);
+    if (!game->levels.solution) {
+        show_hint(game);
+        return;
     }
-    
-    /* Update status line with current box count */
-    if (game->use_colors) {
-        attron(A_BOLD);
+    dirs = (unsigned char*)malloc(game->levels.solution_moves);
+    if (!dirs) {
+        return;
     }
-    mvprintw(start_y + game->height + 3, start_x, "Boxes: %d/%d", game->boxes_on_goal, game->boxes_total);
-    if (game->use_colors) {
-        attroff(A_BOLD);
+    for (i = 0; i < game->levels.solution_moves; i++) {
+        dirs[i] = SOLUTION_MOVE(game->levels.solution, i);
     }
-    
-    /* Check if level is complete */
-    if (game->boxes_on_goal == game->boxes_total) {
-        if (game->use_colors) {
-            attron(A_STANDOUT);
+    seek_history(game, 0);
+    play_moves(game, dirs, game->levels.solution_moves);
+    free(dirs);
+}
+
+/* Animate moves at game->fps, timed against the monotonic clock: when
+ * drawing falls behind, the moves due are made together and only the last
+ * is shown. At fps 0 every move gets a frame, as fast as they can be sent.
+ * + and - double or halve the speed, any other key or a blocked move stops;
+ * returns the moves made */
+int play_moves(Game* game, const unsigned char* dirs, int count) {
+    int batch = game->batch;
+    uint64_t base = stats_now(), now, frame = 0, start;
+    long due, made = 0;
+    int i = 0, wait, ch, blocked = 0;
+
+    game->batch = 1;
+    while (i < count && !blocked) {
+        if (game->fps > 0) {
+            frame = (uint64_t)(1e9 / game->fps);
+            now = stats_now();
+            wait = base + made * frame > now ? (int)((base + made * frame - now + 999999) / 1000000) : 0;
+        } else {
+            wait = 0;
         }
-        mvprintw(start_y + game->height + 3, start_x, "Level complete! Press 'n' for next level.");
-        if (game->use_colors) {
-            attroff(A_STANDOUT);
+
+        /* The wait for the next frame doubles as the key check */
+        wtimeout(input_win, wait);
+        ch = wgetch(input_win);
+        if (ch == '+' || ch == '-') {
+            /* fps 0 is max speed: + keeps it, - drops to the fastest paced speed */
+            if (game->fps == 0) {
+                game->fps = ch == '+' ? 0 : MAX_FPS;
+            } else {
+                game->fps = ch == '+' ? game->fps * 2 : game->fps / 2;
+                game->fps = game->fps > MAX_FPS ? MAX_FPS : game->fps < 0.5 ? 0.5 : game->fps;
+            }
+            base = stats_now();
+            made = 0;
+            continue;
+        } else if (ch != ERR) {
+            break;
+        }
+
+        due = game->fps > 0 ? (long)((stats_now() - base) / frame) + 1 : made + 1;
+        if (due <= made) {
+            continue;
+        }
+        for (; i < count && made < due; i++, made++) {
+            if (!step_dir(game, dirs[i])) {
+                blocked = 1;
+                break;
+            }
+        }
+        if (game->fps > 0) {
+            mvprintw(game->screen.start_y + game->screen.view_h + 3, game->screen.start_x,
+                     "Playing %d/%d at %.4g fps: +/- speed, any key stops", i, count, game->fps);
+            clrtoeol();
+            game->screen.status_shown = -1;
+        }
+        start = stats_enabled ? stats_now() : 0;
+        refresh();
+        if (stats_enabled) {
+            stats_time(STAT_REFRESH, start);
+            stats_frame();
         }
     }
-    
-    refresh();
-    return 1;
+    /* Back to how the main loop reads keys: without waiting while in a batch */
+    nodelay(input_win, batch ? TRUE : FALSE);
+    game->batch = batch;
+    game->screen.status_shown = -1;
+    draw_status(game);
+    if (blocked) {
+        mvprintw(game->screen.start_y + game->screen.view_h + 3, game->screen.start_x,
+                 "Move %d of %d is blocked, playback stopped", i + 1, count);
+        clrtoeol();
+        game->screen.status_shown = -1;
+    }
+    if (!batch) {
+        refresh();
+    }
+    return i;
+}
+
+/* Read a LURD move string, blanks ignored, as directions; NULL on error */
+unsigned char* read_moves(const char* path, int* count) {
+    FILE* file = fopen(path, "r");
+    unsigned char* dirs = NULL;
+    unsigned char* grown;
+    int capacity = 0, ch, d;
+
+    *count = 0;
+    if (!file) {
+        perror(path);
+        return NULL;
+    }
+    while ((ch = fgetc(file)) != EOF) {
+        if (isspace(ch)) {
+            continue;
+        }
+        d = board_dir_from_char(ch);
+        if (d < 0) {
+            fprintf(stderr, "%s: not a LURD move: '%c'\n", path, ch);
+            free(dirs);
+            fclose(file);
+            return NULL;
+        }
+        if (*count == capacity) {
+            capacity = capacity ? capacity * 2 : 1024;
+            grown = (unsigned char*)realloc(dirs, capacity);
+            if (!grown) {
+                free(dirs);
+                fclose(file);
+                return NULL;
+            }
+            dirs = grown;
+        }
+        dirs[(*count)++] = (unsigned char)d;
+    }
+    fclose(file);
+    if (*count == 0) {
+        fprintf(stderr, "%s: no moves\n", path);
+        free(dirs);
+        return NULL;
+    }
+    return dirs;
 }
 
+/* Start a search for a good push from the current position; the answer
+ * shows up through poll_hint() */
+void request_hint(Game* game) {
+    const Board* b = &game->board;
+
+    clear_hint(game);
+    if (b->boxes_on_goal == b->boxes_total) {
+        return;
+    }
+    game->hint_serial = hint_request(&game->hints, b);
+    if (game->hint_serial < 0) {
+        game->hint_serial = 0;
+        mvprintw(game->screen.start_y + game->screen.view_h + 3, game->screen.start_x, "Hint search could not start");
+    } else {
+        mvprintw(game->screen.start_y + game->screen.view_h + 3, game->screen.start_x, "Hint: thinking...");
+    }
+    clrtoeol();
+    game->screen.status_shown = -1;
+}
+
+/* Show the latest answer to the awaited hint request, if any */
+void poll_hint(Game* game) {
+    static const char* dir_names[4] = { "left", "up", "right", "down" };
+    Hint hint;
+    int old = game->hint_box;
+
+    if (!hint_poll(&game->hints, &hint) || hint.serial != game->hint_serial) {
+        return;
+    }
+    if (hint.done) {
+        game->hint_serial = 0;
+    }
+    game->hint_box = hint.box;
+    if (old >= 0) {
+        draw_cell(game, old);
+    }
+    if (hint.box >= 0) {
+        draw_cell(game, hint.box);
+    }
+
+    if (hint.unsolvable) {
+        mvprintw(game->screen.start_y + game->screen.view_h + 3, game->screen.start_x, "No solution from here: [U]ndo or [R]estart");
+    } else if (hint.box < 0) {
+        mvprintw(game->screen.start_y + game->screen.view_h + 3, game->screen.start_x, "No hint found");
+    } else if (hint.pushes > 0) {
+        mvprintw(game->screen.start_y + game->screen.view_h + 3, game->screen.start_x, "Hint: push the highlighted box %s (%d pushes to go)",
+                 dir_names[hint.dir], hint.pushes);
+    } else {
+        mvprintw(game->screen.start_y + game->screen.view_h + 3, game->screen.start_x, "Hint: push the highlighted box %s (%s)",
+                 dir_names[hint.dir], hint.done ? "best guess" : "thinking...");
+    }
+    clrtoeol();
+    game->screen.status_shown = -1;
+    if (!game->batch) {
+        refresh();
+    }
+}
+
+/* Drop the awaited or shown hint, putting the status line back */
+void clear_hint(Game* game) {
+    int old = game->hint_box;
+
+    if (old < 0 && !game->hint_serial) {
+        return;
+    }
+    if (game->hint_serial) {
+        hint_cancel(&game->hints);
+    }
+    game->hint_serial = 0;
+    game->hint_box = -1;
+    if (old >= 0) {
+        draw_cell(game, old);
+    }
+    game->screen.status_shown = -1;
+    draw_status(game);
+}
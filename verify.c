@@ -0,0 +1,212 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "verify.h"
+
+/* Solution files end in this, their level is NAME.sok next to them or
+ * the embedded level NAME */
+#define SOLUTION_EXT ".sol"
+
+/* Outcome of one solution file */
+typedef struct {
+    char* name;             /* File name, without the directory */
+    int passed;
+    long moves;
+    long pushes;
+    char problem[96];       /* Why it failed */
+} Check;
+
+typedef struct {
+    const char* dir;
+    Check* checks;
+    int count;
+    const LevelSet* levels; /* Embedded levels to look names up in */
+    atomic_int next;
+    atomic_long moves;      /* Moves applied, over all threads */
+} Verifier;
+
+static int compare_checks(const void* a, const void* b) {
+    return strcmp(((const Check*)a)->name, ((const Check*)b)->name);
+}
+
+/* Read a whole file into a string; NULL on error */
+static char* read_file(const char* path) {
+    FILE* file = fopen(path, "rb");
+    char* text = NULL;
+    long size;
+
+    if (!file) {
+        return NULL;
+    }
+    if (fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) >= 0 &&
+        fseek(file, 0, SEEK_SET) == 0 && (text = (char*)malloc(size + 1)) != NULL) {
+        if (fread(text, 1, size, file) != (size_t)size) {
+            free(text);
+            text = NULL;
+        } else {
+            text[size] = '\0';
+        }
+    }
+    fclose(file);
+    return text;
+}
+
+/* Replay one solution on its level with the game's move rule */
+static void check_solution(Verifier* v, Check* c, Board* board) {
+    char path[1024];
+    char* moves;
+    const char* p;
+    size_t stem = strlen(c->name) - strlen(SOLUTION_EXT);
+    StepChange change;
+    int dir, step;
+
+    snprintf(path, sizeof(path), "%s/%.*s.sok", v->dir, (int)stem, c->name);
+    if (access(path, R_OK) != 0) {
+        snprintf(path, sizeof(path), "%.*s", (int)stem, c->name);
+    }
+    if (levels_load_named(v->levels, path, board) != 0) {
+        snprintf(c->problem, sizeof(c->problem), "level %.60s not found or invalid", path);
+        return;
+    }
+    snprintf(path, sizeof(path), "%s/%s", v->dir, c->name);
+    moves = read_file(path);
+    if (!moves) {
+        snprintf(c->problem, sizeof(c->problem), "cannot read the solution");
+        return;
+    }
+
+    for (p = moves; *p; p++) {
+        if (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') {
+            continue;
+        }
+        dir = board_dir_from_char(*p);
+        if (dir < 0) {
+            snprintf(c->problem, sizeof(c->problem), "move %ld: not a LURD move: '%c'",
+                     c->moves + 1, *p);
+            break;
+        }
+        step = engine_step(board, dir, &change);
+        if (step < 0) {
+            snprintf(c->problem, sizeof(c->problem), "move %ld (%c) is blocked",
+                     c->moves + 1, *p);
+            break;
+        }
+        c->moves++;
+        c->pushes += step;
+    }
+    free(moves);
+    atomic_fetch_add(&v->moves, c->moves);
+
+    if (!c->problem[0] && board->boxes_on_goal != board->boxes_total) {
+        snprintf(c->problem, sizeof(c->problem), "level not solved: %d of %d boxes on goals",
+                 board->boxes_on_goal, board->boxes_total);
+    }
+    c->passed = !c->problem[0];
+}
+
+/* Thread body: take files until none are left */
+static void* verify_worker(void* arg) {
+    Verifier* v = (Verifier*)arg;
+    Board board;
+    int i;
+
+    memset(&board, 0, sizeof(board));
+    while ((i = atomic_fetch_add(&v->next, 1)) < v->count) {
+        check_solution(v, &v->checks[i], &board);
+    }
+    board_free(&board);
+    return NULL;
+}
+
+/* Check every solution file in dir on threads threads, print one line per
+ * file and a summary; returns the number that failed, -1 on error */
+int verify_dir(const char* dir, int threads, const LevelSet* levels) {
+    Verifier v;
+    DIR* d;
+    struct dirent* entry;
+    Check* grown;
+    pthread_t* tids;
+    int capacity = 0, failed = 0, started, i;
+    size_t len;
+    double start = engine_seconds(), seconds;
+
+    memset(&v, 0, sizeof(v));
+    v.dir = dir;
+    v.levels = levels;
+    d = opendir(dir);
+    if (!d) {
+        perror(dir);
+        return -1;
+    }
+    while ((entry = readdir(d)) != NULL) {
+        len = strlen(entry->d_name);
+        if (len <= strlen(SOLUTION_EXT) ||
+            strcmp(entry->d_name + len - strlen(SOLUTION_EXT), SOLUTION_EXT) != 0) {
+            continue;
+        }
+        if (v.count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            grown = (Check*)realloc(v.checks, capacity * sizeof(Check));
+            if (!grown) {
+                break;
+            }
+            v.checks = grown;
+        }
+        memset(&v.checks[v.count], 0, sizeof(Check));
+        v.checks[v.count].name = strdup(entry->d_name);
+        if (v.checks[v.count].name) {
+            v.count++;
+        }
+    }
+    closedir(d);
+    if (v.count == 0) {
+        fprintf(stderr, "No %s files in %s\n", SOLUTION_EXT, dir);
+        free(v.checks);
+        return -1;
+    }
+    qsort(v.checks, v.count, sizeof(Check), compare_checks);
+
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (threads > v.count) {
+        threads = v.count;
+    }
+    atomic_init(&v.next, 0);
+    atomic_init(&v.moves, 0);
+    tids = (pthread_t*)calloc(threads, sizeof(pthread_t));
+    for (i = 1; tids && i < threads; i++) {
+        if (pthread_create(&tids[i], NULL, verify_worker, &v) != 0) {
+            break;
+        }
+    }
+    /* This thread is a worker too; report how many actually ran */
+    started = i;
+    verify_worker(&v);
+    while (tids && --i > 0) {
+        pthread_join(tids[i], NULL);
+    }
+    free(tids);
+    seconds = engine_seconds() - start;
+
+    for (i = 0; i < v.count; i++) {
+        if (v.checks[i].passed) {
+            printf("PASS %-24s %7ld moves %6ld pushes\n", v.checks[i].name, v.checks[i].moves,
+                   v.checks[i].pushes);
+        } else {
+            printf("FAIL %-24s %s\n", v.checks[i].name, v.checks[i].problem);
+            failed++;
+        }
+        free(v.checks[i].name);
+    }
+    printf("Verified %d solutions on %d thread%s in %.3f s: %d passed, %d failed, "
+           "%ld moves (%.0f moves/s)\n", v.count, started, started == 1 ? "" : "s", seconds, v.count - failed, failed,
+           atomic_load(&v.moves), seconds > 0 ? atomic_load(&v.moves) / seconds : 0.0);
+    free(v.checks);
+    return failed;
+}
@@ -0,0 +1,8 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include "engine.h"
+
+int verify_dir(const char* dir, int threads, const LevelSet* levels);
+
+#endif /* VERIFY_H */